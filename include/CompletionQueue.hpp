@@ -0,0 +1,86 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <optional>
+#include <condition_variable>
+#include "JobResult.hpp"
+#include "Job.hpp"
+
+/**
+ * @brief Class, that describes queue of finished jobs.
+ * Jobs, added to thread pool with completion queue,
+ * push their results here in order of completion.
+ */
+class CompletionQueue
+{
+    friend class ThreadPool;
+public:
+
+    /**
+     * @brief Finished job.
+     */
+    struct Completion
+    {
+        Job::Index index;
+        JobResult::State state;
+        Job::Result result;
+    };
+
+    /**
+     * @brief Constructor.
+     */
+    CompletionQueue();
+
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+    /**
+     * @brief Method for taking finished job
+     * without waiting.
+     * @return Finished job or empty optional
+     * if there is no finished jobs.
+     */
+    std::optional<Completion> poll();
+
+    /**
+     * @brief Method for taking finished job.
+     * Waits until any job will be finished.
+     * @return Finished job.
+     */
+    Completion waitOne();
+
+    /**
+     * @brief Method for taking up to `count` finished
+     * jobs without waiting.
+     * @param count Maximum number of jobs.
+     * @return Finished jobs in order of completion.
+     */
+    std::vector<Completion> drain(std::size_t count);
+
+    /**
+     * @brief Method for getting number of
+     * finished not taken jobs.
+     * @return Number of jobs.
+     */
+    std::size_t size() const;
+
+private:
+
+    /**
+     * @brief Method for pushing finished job
+     * and waking up one waiting thread.
+     * @param completion Finished job.
+     */
+    void push(Completion completion);
+
+    std::deque<Completion> m_completions;
+    std::condition_variable m_condition;
+    mutable std::mutex m_mutex;
+};
+
@@ -13,6 +13,7 @@
 class Job
 {
     friend class ThreadPool;
+    friend class Strand;
 public:
     using Index = uint32_t;
 
@@ -39,9 +40,9 @@ public:
 
     /**
      * @brief Method for getting job function to execute.
-     * @return
+     * @return Reference to function.
      */
-    FunctionType function() const;
+    const FunctionType& function() const;
 
 private:
     void setIndex(Index index);
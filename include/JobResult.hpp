@@ -15,6 +15,18 @@ class JobResult
 {
 public:
 
+    /**
+     * @brief Job state.
+     */
+    enum class State
+    {
+        Pending,  //< Job is not finished yet
+        Finished, //< Job was executed and result is set
+        Expired,  //< Job deadline passed before execution
+        Rejected, //< Job was not accepted or dropped by full queue
+        Removed   //< Job was removed with ThreadPool::removeJob before execution
+    };
+
     /**
      * @brief Default constructor.
      */
@@ -38,11 +50,26 @@ public:
         }
     }
 
+    /**
+     * @brief Method for getting current job state.
+     * @return Job state.
+     */
+    State state() const
+    {
+        if (m_impl)
+        {
+            return m_impl->state();
+        }
+
+        return State::Pending;
+    }
+
     /**
      * @brief Method for getting value from result.
      * If result is not ready, wait for it.
      * @tparam T Result type.
-     * @return Copy of value.
+     * @return Copy of value. If job has no
+     * value (for example it's expired) T(0).
      */
     template<typename T>
     T get()
@@ -50,7 +77,13 @@ public:
         if (m_impl)
         {
             waitForResult();
-            return *m_impl->get<T>();
+
+            auto data = m_impl->get<T>();
+
+            if (data)
+            {
+                return *data;
+            }
         }
 
         return T(0);
@@ -59,6 +92,7 @@ public:
 private:
 
     friend class ThreadPool;
+    friend class Strand;
 
     /**
      * @brief Thread safe job result implementation.
@@ -95,6 +129,19 @@ private:
          */
         void set(std::shared_ptr<void> data);
 
+        /**
+         * @brief Method for finishing job without
+         * result and notify all waiting threads.
+         * @param state Final job state.
+         */
+        void finish(State state);
+
+        /**
+         * @brief Method for getting current job state.
+         * @return Job state.
+         */
+        State state() const;
+
         /**
          * @brief Method for waiting until
          * job will return result.
@@ -105,7 +152,7 @@ private:
         Job m_job;
 
         std::shared_ptr<void> m_data;
-        bool m_resultReceived;
+        State m_state;
         std::condition_variable m_conditionVariable;
         mutable std::mutex m_mutex;
     };
@@ -0,0 +1,168 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include "Job.hpp"
+
+class ThreadPool;
+
+/**
+ * @brief Class, that describes multi-stage pipeline,
+ * executed by thread pool workers. Items are produced
+ * by serial input function and passed through stages
+ * without copying. Number of items in flight is limited,
+ * so slow stages cause backpressure on input.
+ */
+class Pipeline
+{
+public:
+
+    /**
+     * @brief Stage execution mode.
+     */
+    enum class Mode
+    {
+        SerialInOrder,    //< One item at a time, in order of input
+        SerialOutOfOrder, //< One item at a time, in any order
+        Parallel          //< Any number of items at a time
+    };
+
+    /**
+     * @brief Input function type. Returns next
+     * item or nullptr if there is no more items.
+     */
+    using InputFunction = std::function<Job::Result()>;
+
+    /**
+     * @brief Stage function type. Takes item and
+     * returns item for next stage.
+     */
+    using StageFunction = std::function<Job::Result(Job::Result)>;
+
+    /**
+     * @brief Constructor.
+     * @param pool Thread pool, that will execute stages.
+     * @param input Input function.
+     */
+    Pipeline(ThreadPool& pool, InputFunction input);
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    /**
+     * @brief Method for adding stage to the
+     * end of pipeline.
+     * @param mode Stage mode.
+     * @param function Stage function.
+     * @return Reference to pipeline.
+     */
+    Pipeline& addStage(Mode mode, StageFunction function);
+
+    /**
+     * @brief Method for running pipeline until input
+     * will be exhausted. Blocks until all items pass
+     * all stages. Has not to be called from
+     * worker of the same pool.
+     * @param maxTokens Maximum number of items in flight.
+     */
+    void run(std::size_t maxTokens);
+
+private:
+
+    /**
+     * @brief Item with it's input sequence number.
+     */
+    struct Token
+    {
+        std::size_t sequence;
+        Job::Result item;
+    };
+
+    struct Stage
+    {
+        Stage(Mode mode, StageFunction function) :
+            mode(mode),
+            function(std::move(function)),
+            busy(false),
+            nextSequence(0),
+            waiting(),
+            mutex()
+        {}
+
+        Mode mode;
+        StageFunction function;
+
+        // Serial stages state
+        bool busy;
+        std::size_t nextSequence;
+        std::map<std::size_t, Token> waiting;
+        std::mutex mutex;
+    };
+
+    /**
+     * @brief Method for reading next item from input.
+     * @param token Output token.
+     * @return False if input is exhausted.
+     */
+    bool readInput(Token& token);
+
+    /**
+     * @brief Token slot job. Takes items from input
+     * and drives them through stages.
+     */
+    void startSlot();
+
+    /**
+     * @brief Method for driving token through stages and
+     * taking next items from input, while it's possible.
+     * @param token Token.
+     * @param stage Stage to start from.
+     * @param claimed Is this stage already claimed for token.
+     */
+    void drive(Token token, std::size_t stage, bool claimed);
+
+    /**
+     * @brief Method for passing token through
+     * remaining stages.
+     * @param token Token.
+     * @param stage Stage to start from.
+     * @param claimed Is this stage already claimed for token.
+     * @return False if token was parked at serial stage.
+     */
+    bool advance(Token& token, std::size_t stage, bool claimed);
+
+    /**
+     * @brief Method for releasing serial stage after
+     * token processing and scheduling next parked
+     * token if it's eligible.
+     * @param stage Stage index.
+     */
+    void release(std::size_t stage);
+
+    /**
+     * @brief Method for marking token slot as finished.
+     */
+    void finishSlot();
+
+    ThreadPool& m_pool;
+
+    InputFunction m_input;
+    bool m_inputDone;
+    std::size_t m_inputSequence;
+    std::mutex m_inputMutex;
+
+    std::vector<std::unique_ptr<Stage>> m_stages;
+
+    std::size_t m_activeSlots;
+    std::condition_variable m_finishedCondition;
+    std::mutex m_mutex;
+};
+
@@ -0,0 +1,78 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "JobResult.hpp"
+#include "Job.hpp"
+
+class ThreadPool;
+
+/**
+ * @brief Class, that describes serial executor on top
+ * of thread pool. Jobs, added to one strand, are executed
+ * one at a time in order of adding, but strand itself
+ * does not own any thread. While strand has queued jobs
+ * it's executed by the same worker.
+ */
+class Strand
+{
+public:
+
+    /**
+     * @brief Maximum number of jobs, that will be executed
+     * by one worker in a row before strand gives worker
+     * back to pool.
+     */
+    static const std::size_t MaxBatch = 64;
+
+    /**
+     * @brief Constructor.
+     * @param pool Thread pool, that will execute
+     * strand jobs. Pool has to outlive strand.
+     */
+    explicit Strand(ThreadPool& pool);
+
+    /**
+     * @brief Destructor. Waits until all
+     * queued jobs will be finished.
+     */
+    ~Strand();
+
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    /**
+     * @brief Method for adding job to strand.
+     * @param job Job.
+     * @return Job result. It will contain job result
+     * when job will be finished.
+     */
+    JobResult addJob(Job job);
+
+private:
+
+    struct JobContainer
+    {
+        Job job;
+        JobResult result;
+    };
+
+    /**
+     * @brief Method, that's executed by pool worker.
+     * Executes queued jobs one by one.
+     */
+    void drain();
+
+    ThreadPool& m_pool;
+
+    std::deque<JobContainer> m_jobs;
+    bool m_scheduled;
+    std::condition_variable m_idleCondition;
+    std::mutex m_mutex;
+};
+
@@ -0,0 +1,127 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+class ThreadPool;
+
+/**
+ * @brief Class, that describes reusable graph of
+ * dependent tasks. Graph is built and validated once
+ * and then can be executed by thread pool many times.
+ * Task is scheduled as soon as it's last predecessor
+ * is finished, workers never wait for dependencies.
+ */
+class TaskGraph
+{
+public:
+
+    using Node = uint32_t;
+
+    using FunctionType = std::function<void()>;
+
+    /**
+     * @brief Constructor.
+     */
+    TaskGraph();
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    /**
+     * @brief Method for adding task to graph.
+     * @param function Task function.
+     * @return Node.
+     */
+    Node addNode(FunctionType function);
+
+    /**
+     * @brief Method for adding dependency. Task `to`
+     * will be executed only after task `from`.
+     * If there is no such nodes nothing happen.
+     * @param from Predecessor node.
+     * @param to Successor node.
+     */
+    void precede(Node from, Node to);
+
+    /**
+     * @brief Method for validating graph. Graph
+     * has to be validated after last change and
+     * before execution.
+     * @return False if graph has cycle.
+     */
+    bool validate();
+
+    /**
+     * @brief Method for checking is graph validated.
+     * @return Is graph valid.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Method for executing graph with thread pool.
+     * Blocks until all tasks will be finished. Has not
+     * to be called from worker of the same pool.
+     * Only one execution at a time is allowed.
+     * @param pool Thread pool.
+     * @return False if graph is not valid.
+     */
+    bool run(ThreadPool& pool);
+
+    /**
+     * @brief Method for getting number of nodes.
+     * @return Number of nodes.
+     */
+    std::size_t size() const;
+
+private:
+
+    struct NodeContainer
+    {
+        explicit NodeContainer(FunctionType function) :
+            function(std::move(function)),
+            successors(),
+            predecessors(0),
+            pending(0)
+        {}
+
+        FunctionType function;
+        std::vector<Node> successors;
+        uint32_t predecessors;
+
+        // Number of not finished predecessors in current run
+        std::atomic<uint32_t> pending;
+    };
+
+    /**
+     * @brief Method for executing node and it's successors,
+     * that became ready.
+     * @param node Node.
+     */
+    void execute(Node node);
+
+    /**
+     * @brief Method for scheduling node on pool.
+     * @param node Node.
+     */
+    void schedule(Node node);
+
+    std::vector<std::unique_ptr<NodeContainer>> m_nodes;
+    std::vector<Node> m_roots;
+    bool m_valid;
+
+    ThreadPool* m_pool;
+    std::atomic<std::size_t> m_remaining;
+    bool m_finished;
+    std::condition_variable m_finishedCondition;
+    std::mutex m_mutex;
+};
+
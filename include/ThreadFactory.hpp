@@ -0,0 +1,185 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#pragma once
+
+#include <string>
+#include <functional>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @brief Class, that creates worker threads for
+ * thread pool. Allows to set stack size, thread name,
+ * nice value, scheduling policy and per-worker hooks.
+ * Can be inherited to customize thread creation:
+ * derived factory creates thread itself, calls run
+ * from it and wraps handle with adopt.
+ */
+class ThreadFactory
+{
+public:
+
+    /**
+     * @brief Worker threads options.
+     */
+    struct Options
+    {
+        // Thread name prefix. Worker names are "<name>/<index>",
+        // compensating workers are "<name>/+". Names are truncated
+        // to 15 characters. Empty name keeps system default.
+        std::string name{};
+
+        // Stack size in bytes. 0 keeps system default. Size
+        // below PTHREAD_STACK_MIN makes create throw.
+        std::size_t stackSize = 0;
+
+        // Nice value of thread. 0 keeps process value.
+        int niceValue = 0;
+
+        // Scheduling policy (SCHED_OTHER, SCHED_FIFO, SCHED_RR)
+        // and it's priority. Failure to set it (for example
+        // because of lack of privileges) is ignored.
+        int schedulingPolicy = SCHED_OTHER;
+        int schedulingPriority = 0;
+
+        // Functions, that are called by worker before taking
+        // first job and after last one. Take worker index
+        // (-1 for compensating workers).
+        std::function<void(int)> onStart{};
+        std::function<void(int)> onStop{};
+    };
+
+    /**
+     * @brief Class, that describes created thread.
+     */
+    class Thread
+    {
+        friend class ThreadFactory;
+    public:
+
+        /**
+         * @brief Default constructor. Creates
+         * not joinable thread.
+         */
+        Thread();
+
+        /**
+         * @brief Destructor. Thread has to be
+         * joined before destruction, otherwise
+         * std::terminate is called (as std::thread does).
+         */
+        ~Thread();
+
+        Thread(Thread&& rhs) noexcept;
+
+        /**
+         * @brief Move assignment operator. Calls
+         * std::terminate if this thread is joinable.
+         */
+        Thread& operator=(Thread&& rhs) noexcept;
+
+        Thread(const Thread&) = delete;
+        Thread& operator=(const Thread&) = delete;
+
+        /**
+         * @brief Method for checking is thread
+         * can be joined.
+         * @return Is thread joinable.
+         */
+        bool joinable() const;
+
+        /**
+         * @brief Method for waiting until
+         * thread will finish.
+         */
+        void join();
+
+    private:
+        pthread_t m_handle;
+        bool m_joinable;
+    };
+
+    /**
+     * @brief Default constructor. Threads
+     * are created with default options.
+     */
+    ThreadFactory();
+
+    /**
+     * @brief Constructor.
+     * @param options Worker threads options.
+     */
+    explicit ThreadFactory(Options options);
+
+    /**
+     * @brief Virtual destructor.
+     */
+    virtual ~ThreadFactory() = default;
+
+    /**
+     * @brief Method for creating worker thread.
+     * Throws std::system_error if thread can't be created.
+     * @param index Worker index or -1 for compensating worker.
+     * @param body Worker function.
+     * @return Created thread.
+     */
+    virtual Thread create(int index, std::function<void()> body);
+
+    /**
+     * @brief Method for getting worker threads options.
+     * @return Options.
+     */
+    const Options& options() const;
+
+protected:
+
+    /**
+     * @brief Method for wrapping thread, that was
+     * created by derived factory. Returned object
+     * owns thread and has to be joined.
+     * @param handle Handle of running thread.
+     * @return Thread.
+     */
+    static Thread adopt(pthread_t handle);
+
+    /**
+     * @brief Method, that has to be executed by
+     * created thread. Applies options, calls hooks
+     * and worker function.
+     * @param index Worker index.
+     * @param body Worker function.
+     */
+    void run(int index, const std::function<void()>& body) const;
+
+private:
+
+    /**
+     * @brief Data, passed to created thread.
+     */
+    struct StartData
+    {
+        const ThreadFactory* factory;
+        int index;
+        std::function<void()> body;
+    };
+
+    /**
+     * @brief Created thread entry point.
+     * @param argument Pointer to StartData.
+     * @return nullptr.
+     */
+    static void* start(void* argument);
+
+    /**
+     * @brief Method, that's executed by created thread
+     * before worker function. Applies options that can
+     * be set only from thread itself.
+     * @param index Worker index.
+     */
+    void setup(int index) const;
+
+    Options m_options;
+};
+
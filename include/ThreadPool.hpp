@@ -6,20 +6,93 @@
 
 #include <thread>
 #include <vector>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <algorithm>
+#include <condition_variable>
 #include <functional>
 #include <deque>
 #include <mutex>
-#include <shared_mutex>
 #include "JobResult.hpp"
 #include "Job.hpp"
+#include "ThreadFactory.hpp"
 #include <ringbuffer.hpp>
 #include <list>
+#include <string>
+#include <unordered_map>
+#include <type_traits>
+
+class WorkerLocalBase;
+class CompletionQueue;
 
 /**
  * @brief Main thread pool class.
  */
 class ThreadPool
 {
+    friend class Strand;
+    friend class Pipeline;
+    friend class TaskGraph;
+    template<typename> friend class WorkerLocal;
+
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    static const std::size_t MaxElements = 1024;
+
+    static const std::size_t CacheLineSize = 64;
+
+    using QueueIndex = uint32_t;
+
+private:
+
+    /**
+     * @brief Job kind.
+     */
+    enum class JobType
+    {
+        Regular,  //< Job with result or internal job
+        Infinite, //< Job, that's stored in m_infiniteJobs
+        Triggered //< Job, that's stored in m_triggeredJobs
+    };
+
+    /**
+     * @brief Infinite job. Ready jobs are linked into
+     * intrusive run list, so they are requeued without
+     * copying and without queue size limit.
+     */
+    struct InfiniteJob
+    {
+        enum class State
+        {
+            Ready,   //< Linked into run list
+            Waiting, //< Waiting for interval in timers heap
+            Running  //< Executing
+        };
+
+        InfiniteJob(Job job, Clock::duration interval, uint32_t budget) :
+            job(std::move(job)),
+            interval(interval),
+            budget(budget),
+            nextRun(),
+            state(State::Ready),
+            removed(false),
+            previous(nullptr),
+            next(nullptr)
+        {}
+
+        Job job;
+        Clock::duration interval;
+        uint32_t budget;
+        Clock::time_point nextRun;
+        State state;
+        bool removed;
+
+        InfiniteJob* previous;
+        InfiniteJob* next;
+    };
 
     /**
      * @brief Container for job.
@@ -28,48 +101,239 @@ class ThreadPool
     {
         JobContainer() :
             job(),
-            isInfinite(false),
-            result()
+            type(JobType::Regular),
+            result(),
+            deadline(Clock::time_point::max()),
+            completionQueue(nullptr),
+            infiniteJob(nullptr)
         {}
 
-        JobContainer(Job j, bool isInfinite) :
+        JobContainer(Job j, JobType type) :
             job(std::move(j)),
-            isInfinite(isInfinite),
-            result()
+            type(type),
+            result(),
+            deadline(Clock::time_point::max()),
+            completionQueue(nullptr),
+            infiniteJob(nullptr)
         {}
 
-        JobContainer(Job j, JobResult result) :
+        JobContainer(Job j, JobResult result, Clock::time_point deadline=Clock::time_point::max()) :
             job(std::move(j)),
-            isInfinite(false),
-            result(std::move(result))
+            type(JobType::Regular),
+            result(std::move(result)),
+            deadline(deadline),
+            completionQueue(nullptr),
+            infiniteJob(nullptr)
+        {}
+
+        explicit JobContainer(InfiniteJob* infiniteJob) :
+            job(),
+            type(JobType::Infinite),
+            result(),
+            deadline(Clock::time_point::max()),
+            completionQueue(nullptr),
+            infiniteJob(infiniteJob)
         {}
 
+        /**
+         * @brief Method for getting index of
+         * contained job.
+         * @return Job index.
+         */
+        Job::Index index() const
+        {
+            return infiniteJob ? infiniteJob->job.index() : job.index();
+        }
+
+        /**
+         * @brief Method for checking is this job
+         * internal. Nobody waits for result of
+         * such job, so it can't be dropped.
+         * @return Is job internal.
+         */
+        bool isInternal() const
+        {
+            return !result.m_impl && completionQueue == nullptr;
+        }
+
         Job job{};
-        bool isInfinite;
+        JobType type;
         JobResult result{};
+        Clock::time_point deadline;
+        CompletionQueue* completionQueue;
+        InfiniteJob* infiniteJob; //< Owned by m_infiniteJobs
     };
 
-    struct ThreadContainer
+    /**
+     * @brief Job, that's executed on trigger.
+     */
+    struct TriggeredJob
+    {
+        enum class State
+        {
+            Parked,  //< Waiting for trigger
+            Queued,  //< Waiting for worker
+            Running  //< Executing
+        };
+
+        explicit TriggeredJob(Job job) :
+            job(std::move(job)),
+            state(State::Parked),
+            pending(false)
+        {}
+
+        Job job;
+        State state;
+        bool pending; //< Was triggered while running
+    };
+
+    /**
+     * @brief Comparator for earliest deadline
+     * first heap.
+     */
+    struct DeadlineComparator
+    {
+        bool operator()(const JobContainer& lhs, const JobContainer& rhs) const
+        {
+            return lhs.deadline > rhs.deadline;
+        }
+    };
+
+    /**
+     * @brief Comparator for infinite jobs
+     * timers heap.
+     */
+    struct NextRunComparator
+    {
+        bool operator()(const InfiniteJob* lhs, const InfiniteJob* rhs) const
+        {
+            return lhs->nextRun > rhs->nextRun;
+        }
+    };
+
+    /**
+     * @brief Worker slot. Slots are allocated separately
+     * and placed at own cache lines, so workers can check
+     * their stop flag without locking.
+     */
+    struct alignas(CacheLineSize) ThreadContainer
     {
         ThreadContainer() :
             thread(),
-            running(false)
+            running(true),
+            currentJob(0),
+            jobStart(0),
+            reportedJob(0),
+            reportedStart(0),
+            replaced(false)
         {}
 
-        explicit ThreadContainer(std::thread thread) :
-            thread(std::move(thread)),
-            running(true)
+        ThreadFactory::Thread thread;
+        std::atomic_bool running;
+
+        // Watchdog state. Job index 0 means no job.
+        std::atomic<Job::Index> currentJob;
+        std::atomic<Clock::rep> jobStart;
+
+        // Used only by watchdog thread. Infinite and
+        // triggered jobs keep index between runs, so
+        // run is identified by index and start time.
+        Job::Index reportedJob;
+        Clock::rep reportedStart;
+        bool replaced; //< Compensating worker was added
+    };
+
+    struct CompensatingThread
+    {
+        CompensatingThread() :
+            thread(),
+            finished(false)
         {}
 
-        std::thread thread;
-        bool running;
+        ThreadFactory::Thread thread;
+        bool finished;
+    };
+
+    using JobsContainer = ringbuffer<JobContainer, MaxElements>;
+
+    /**
+     * @brief Named submission queue.
+     */
+    struct SubmissionQueue
+    {
+        SubmissionQueue(std::string name, uint32_t weight) :
+            name(std::move(name)),
+            weight(weight),
+            deficit(0),
+            jobs(),
+            deadlineJobs(),
+            submitted(0),
+            taken(0)
+        {}
+
+        /**
+         * @brief Method for getting number of
+         * queued jobs.
+         * @return Number of jobs.
+         */
+        std::size_t depth() const
+        {
+            return jobs.size() + deadlineJobs.size();
+        }
+
+        std::string name;
+        uint32_t weight;
+        int64_t deficit;
+        JobsContainer jobs;
+        std::vector<JobContainer> deadlineJobs; //< Earliest deadline first heap
+
+        uint64_t submitted;
+        uint64_t taken;
     };
 
 public:
 
-    static const std::size_t MaxElements = 1024;
+    /**
+     * @brief Submission queue statistics.
+     */
+    struct QueueStatistics
+    {
+        std::string name{};
+        uint32_t weight = 0;
+        std::size_t depth = 0;  //< Number of queued jobs
+        uint64_t submitted = 0; //< Total number of added jobs
+        uint64_t taken = 0;     //< Total number of jobs taken by workers
+    };
 
-    using JobsContainer = ringbuffer<JobContainer, MaxElements>;
+    /**
+     * @brief Behaviour of submission to full queue.
+     */
+    enum class OverflowPolicy
+    {
+        Block,      //< Wait until queue will have free space (CallerRuns for pool workers)
+        Reject,     //< Reject new job
+        CallerRuns, //< Execute new job in calling thread
+        DropOldest  //< Reject oldest queued job (latest deadline one if there is no other) and add new one
+    };
+
+    using RejectionHandler = std::function<void(const Job&)>;
+
+    /**
+     * @brief Information about job, that's
+     * running longer than threshold.
+     */
+    struct StallInfo
+    {
+        int workerIndex;
+        Job::Index jobIndex;
+        Clock::duration duration;
+    };
+
+    using StallHandler = std::function<void(const StallInfo&)>;
+
+    static const QueueIndex DefaultQueue = 0;
+
+    static const uint32_t DefaultMaxCompensatingWorkers = 16;
 
     /**
      * @brief Constructor.
@@ -77,6 +341,14 @@ public:
      */
     explicit ThreadPool(uint32_t threads=1);
 
+    /**
+     * @brief Constructor.
+     * @param threads Number of threads.
+     * @param factory Factory, that creates
+     * worker threads.
+     */
+    ThreadPool(uint32_t threads, std::shared_ptr<ThreadFactory> factory);
+
     /**
      * @brief Destructor.
      */
@@ -84,7 +356,9 @@ public:
 
     /**
      * @brief Method for changing number of
-     * active threads.
+     * active threads. If thread can't be created,
+     * exception of thread factory is rethrown and
+     * number of threads is not changed.
      * @param threads Threads.
      */
     void changeNumberOfThreads(uint32_t threads);
@@ -103,6 +377,175 @@ public:
      */
     JobResult addJob(Job job);
 
+    /**
+     * @brief Method for adding job to named submission
+     * queue. Workers take jobs from queues with deficit
+     * round robin, so every queue gets share of workers
+     * time according to it's weight.
+     * @param queue Queue index.
+     * @param job Job.
+     * @return Job result. If there is no such queue
+     * it has JobResult::State::Rejected state.
+     */
+    JobResult addJob(QueueIndex queue, Job job);
+
+    /**
+     * @brief Method for trying to add job without waiting.
+     * If queue is full, job is rejected.
+     * @param job Job.
+     * @return Job result. If job was rejected it has
+     * JobResult::State::Rejected state.
+     */
+    JobResult tryAddJob(Job job);
+
+    /**
+     * @brief Method for trying to add job to submission
+     * queue without waiting.
+     * @param queue Queue index.
+     * @param job Job.
+     * @return Job result. If job was rejected it has
+     * JobResult::State::Rejected state.
+     */
+    JobResult tryAddJob(QueueIndex queue, Job job);
+
+    /**
+     * @brief Method for adding job, that waits for
+     * free space in full queue no longer than timeout.
+     * @param job Job.
+     * @param timeout Timeout.
+     * @return Job result. If job was rejected it has
+     * JobResult::State::Rejected state.
+     */
+    JobResult addJobFor(Job job, Clock::duration timeout);
+
+    /**
+     * @brief Method for adding job to submission queue,
+     * that waits for free space in full queue no longer
+     * than timeout.
+     * @param queue Queue index.
+     * @param job Job.
+     * @param timeout Timeout.
+     * @return Job result. If job was rejected it has
+     * JobResult::State::Rejected state.
+     */
+    JobResult addJobFor(QueueIndex queue, Job job, Clock::duration timeout);
+
+    /**
+     * @brief Method for setting behaviour of addJob,
+     * when submission queue is full. Default is
+     * OverflowPolicy::Block. Jobs with deadline are
+     * counted in queue size, infinite and internal
+     * jobs are not limited. Workers of this pool
+     * can't wait for free space, because only they
+     * free it, so OverflowPolicy::Block works as
+     * OverflowPolicy::CallerRuns for them.
+     * @param policy Policy.
+     */
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    /**
+     * @brief Method for setting function, that's called
+     * for every rejected or dropped job.
+     * @param handler Handler.
+     */
+    void setRejectionHandler(RejectionHandler handler);
+
+    /**
+     * @brief Method for getting number of jobs, that
+     * were rejected or dropped because of full queue.
+     * @return Number of rejected jobs.
+     */
+    uint64_t rejectedJobs() const;
+
+    /**
+     * @brief Method for getting number of submissions,
+     * that found queue full (regardless of policy).
+     * @return Number of overflows.
+     */
+    uint64_t overflowedJobs() const;
+
+    /**
+     * @brief Method for adding job, that pushes it's
+     * result to completion queue instead of JobResult.
+     * Completion queue has to outlive job.
+     * @param job Job.
+     * @param completionQueue Completion queue.
+     * @return Job index.
+     */
+    Job::Index addJob(Job job, CompletionQueue& completionQueue);
+
+    /**
+     * @brief Method for adding job to submission queue,
+     * that pushes it's result to completion queue
+     * instead of JobResult.
+     * @param queue Queue index.
+     * @param job Job.
+     * @param completionQueue Completion queue.
+     * @return Job index. 0 if there is no such queue.
+     */
+    Job::Index addJob(QueueIndex queue, Job job, CompletionQueue& completionQueue);
+
+    /**
+     * @brief Method for adding named submission queue.
+     * Default queue (used by addJob without queue)
+     * has weight 1.
+     * @param name Queue name.
+     * @param weight Queue weight. At least 1.
+     * @return Queue index.
+     */
+    QueueIndex addQueue(std::string name, uint32_t weight);
+
+    /**
+     * @brief Method for changing submission queue weight.
+     * @param queue Queue index.
+     * @param weight Queue weight. At least 1.
+     */
+    void setQueueWeight(QueueIndex queue, uint32_t weight);
+
+    /**
+     * @brief Method for getting submission
+     * queue statistics.
+     * @param queue Queue index.
+     * @return Statistics. If there is no such queue,
+     * empty statistics is returned.
+     */
+    QueueStatistics queueStatistics(QueueIndex queue) const;
+
+    /**
+     * @brief Method for adding job, that has to be
+     * started before deadline, to default queue.
+     * @param job Job.
+     * @param deadline Deadline.
+     * @return Job result.
+     */
+    JobResult addJob(Job job, Clock::time_point deadline);
+
+    /**
+     * @brief Method for adding job, that has to be
+     * started before deadline, to submission queue.
+     * Jobs with deadline are taken from queue in earliest
+     * deadline first order before jobs without deadline.
+     * They are counted in queue share as regular jobs,
+     * so deadlines don't give queue more workers time.
+     * If deadline passed before job was taken, job is
+     * dropped without execution and it's result gets
+     * JobResult::State::Expired state. Full queue is
+     * handled according to overflow policy.
+     * @param queue Queue index.
+     * @param job Job.
+     * @param deadline Deadline.
+     * @return Job result. If there is no such queue
+     * it has JobResult::State::Rejected state.
+     */
+    JobResult addJob(QueueIndex queue, Job job, Clock::time_point deadline);
+
+    /**
+     * @brief Method for getting number of jobs, that
+     * were dropped because of passed deadline.
+     * @return Number of expired jobs.
+     */
+    uint64_t expiredJobs() const;
+
     /**
      * @brief Method for adding job that does not has
      * result and will be pushed to job queue after it'll be finished.
@@ -111,9 +554,192 @@ public:
      */
     Job::Index addInfiniteJob(Job job);
 
+    /**
+     * @brief Method for adding infinite job with
+     * cadence. Job is not started earlier than
+     * interval after previous start. Every time
+     * worker takes job, it's executed budget times
+     * in a row. Workers alternate between infinite
+     * jobs and queued jobs.
+     * @param job Job.
+     * @param interval Minimum interval between starts.
+     * @param budget Number of runs per pass.
+     * @return Job index.
+     */
+    Job::Index addInfiniteJob(Job job, Clock::duration interval, uint32_t budget=1);
+
+    /**
+     * @brief Method for adding job, that computes value
+     * identified by key. If job with equal key is queued
+     * or executing, result of that job is returned
+     * instead. If result cache is enabled, results of
+     * finished jobs are returned while they are not
+     * expired.
+     * @param key Job key.
+     * @param job Job.
+     * @return Job result. May be shared with other callers.
+     */
+    JobResult addKeyedJob(const std::string& key, Job job);
+
+    /**
+     * @brief Method for setting up LRU cache of keyed
+     * jobs results.
+     * @param capacity Maximum number of cached results.
+     * 0 disables cache.
+     * @param ttl Time, while result is valid.
+     */
+    void setResultCache(std::size_t capacity, Clock::duration ttl);
+
+    /**
+     * @brief Method for getting number of keyed jobs,
+     * that got result of running job or cached result
+     * instead of being executed.
+     * @return Number of deduplicated jobs.
+     */
+    uint64_t deduplicatedJobs() const;
+
+    /**
+     * @brief Method for adding job, that's executed only
+     * after trigger. Job does not occupy job queue while
+     * it's waiting for trigger. Triggers, that came while
+     * job is queued, are coalesced with it. Trigger, that
+     * came while job is running, causes one more run.
+     * Job can be removed with removeJob.
+     * @param job Job.
+     * @return Job index.
+     */
+    Job::Index addTriggeredJob(Job job);
+
+    /**
+     * @brief Method for triggering job, that was added
+     * with addTriggeredJob. If there is no such job
+     * nothing happen.
+     * @param index Job index.
+     */
+    void trigger(Job::Index index);
+
+    /**
+     * @brief Method for applying function to every
+     * element of range in parallel. Range is split into
+     * contiguous chunks. Result vector is preallocated with
+     * default constructed elements, that are assigned by
+     * workers. Calling thread takes part in processing, so
+     * it's safe to call it from worker. Blocks until all
+     * elements are processed.
+     * @tparam Range Random access range type.
+     * @tparam F Function type. Result type has to be
+     * default constructible and move assignable. It can't
+     * be bool, because std::vector<bool> packs elements
+     * into bits, so return char for predicates.
+     * @param input Input range.
+     * @param function Function, that takes range element.
+     * @return Vector of results in order of input.
+     */
+    template<typename Range, typename F>
+    auto map(const Range& input, F function)
+        -> std::vector<typename std::decay<decltype(function(*std::begin(input)))>::type>
+    {
+        using Result = typename std::decay<decltype(function(*std::begin(input)))>::type;
+        using Iterator = decltype(std::begin(input));
+
+        static_assert(
+            !std::is_same<Result, bool>::value,
+            "ThreadPool::map can't write std::vector<bool> elements concurrently, return char instead"
+        );
+
+        struct State
+        {
+            State(F function, std::size_t chunks) :
+                function(std::move(function)),
+                nextChunk(0),
+                remaining(chunks),
+                mutex(),
+                condition()
+            {}
+
+            F function;
+            std::atomic<std::size_t> nextChunk;
+            std::atomic<std::size_t> remaining;
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+
+        auto size = static_cast<std::size_t>(
+            std::distance(std::begin(input), std::end(input))
+        );
+
+        std::vector<Result> results(size);
+
+        if (size == 0)
+        {
+            return results;
+        }
+
+        auto workers = std::max<std::size_t>(1, numberOfThreads());
+        auto chunkSize = (size + workers * 4 - 1) / (workers * 4);
+        auto chunks = (size + chunkSize - 1) / chunkSize;
+
+        auto state = std::make_shared<State>(std::move(function), chunks);
+
+        Iterator begin = std::begin(input);
+        Result* output = results.data();
+
+        // Chunk is claimed before touching input and output,
+        // so late helpers do not access them after return
+        auto process = [state, begin, output, size, chunkSize, chunks]()
+        {
+            std::size_t chunk;
+
+            while ((chunk = state->nextChunk.fetch_add(1)) < chunks)
+            {
+                auto first = chunk * chunkSize;
+                auto last = std::min(size, first + chunkSize);
+
+                auto iterator = begin;
+                std::advance(iterator, first);
+
+                for (auto i = first; i < last; ++i, ++iterator)
+                {
+                    output[i] = state->function(*iterator);
+                }
+
+                if (state->remaining.fetch_sub(1) == 1)
+                {
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    state->condition.notify_all();
+                }
+            }
+        };
+
+        for (std::size_t i = 1; i < std::min(workers + 1, chunks); ++i)
+        {
+            post(Job(
+                [process]() -> Job::Result
+                {
+                    process();
+                    return nullptr;
+                }
+            ));
+        }
+
+        process();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+
+        while (state->remaining.load() != 0)
+        {
+            state->condition.wait(lock);
+        }
+
+        return results;
+    }
+
     /**
      * @brief Method for removing job from event queue.
-     * If there is no such queue nothing happen.
+     * If there is no such queue nothing happen. Result
+     * of removed job gets JobResult::State::Removed state
+     * (completion with this state is pushed to completion
+     * queue), when worker reaches it in queue.
      * @param index Job index.
      */
     void removeJob(Job::Index index);
@@ -126,25 +752,410 @@ public:
      */
     bool containsJob(Job::Index index) const;
 
+    /**
+     * @brief Method for enabling watchdog, that checks
+     * workers from separate thread and reports jobs,
+     * that are running longer than threshold. Every
+     * job run is reported once. Handler is called from
+     * watchdog thread. If watchdog is already enabled,
+     * it's restarted with new parameters.
+     * @param threshold Maximum job duration.
+     * @param handler Function, that's called for
+     * every stalled job. May be empty.
+     * @param replaceStalled Add compensating worker
+     * for every stalled one. It retires after stalled
+     * job returns. Number of such workers is limited
+     * by setMaxCompensatingWorkers.
+     */
+    void enableWatchdog(Clock::duration threshold,
+                        StallHandler handler,
+                        bool replaceStalled=false);
+
+    /**
+     * @brief Method for disabling watchdog.
+     */
+    void disableWatchdog();
+
+    /**
+     * @brief Method for getting number of
+     * jobs, reported by watchdog.
+     * @return Number of stalled jobs.
+     */
+    uint64_t stalledJobs() const;
+
+    /**
+     * @brief Method for getting index of current
+     * worker thread inside it's thread pool.
+     * @return Worker index or -1 if it's called
+     * not from pool worker.
+     */
+    static int currentWorkerIndex();
+
+    /**
+     * @brief Method for getting index of current
+     * worker thread inside this pool.
+     * @return Worker index or -1 if it's called
+     * not from this pool worker.
+     */
+    int workerIndex() const;
+
+    /**
+     * @brief Method for executing function, that's
+     * going to block current worker (blocking IO,
+     * legacy APIs, etc). While function is executing
+     * pool spawns compensating worker, that will
+     * retire after function is finished. If it's
+     * called not from this pool worker, function
+     * is just executed.
+     * @tparam F Function type.
+     * @param function Function.
+     * @return Function result.
+     */
+    template<typename F>
+    auto blocking(F&& function) -> decltype(function())
+    {
+        BlockingScope scope(*this);
+        return function();
+    }
+
+    /**
+     * @brief Method for setting maximum number
+     * of simultaneously running compensating workers.
+     * @param workers Number of workers.
+     */
+    void setMaxCompensatingWorkers(uint32_t workers);
+
+    /**
+     * @brief Method for getting number of currently
+     * running compensating workers.
+     * @return Number of workers.
+     */
+    uint32_t compensatingWorkers() const;
+
 private:
 
+    /**
+     * @brief RAII helper for blocking regions.
+     */
+    class BlockingScope
+    {
+    public:
+        explicit BlockingScope(ThreadPool& pool) :
+            m_pool(pool)
+        {
+            m_pool.beginBlocking();
+        }
+
+        ~BlockingScope()
+        {
+            m_pool.endBlocking();
+        }
+
+    private:
+        ThreadPool& m_pool;
+    };
+
+    /**
+     * @brief Method for notifying pool, that current
+     * worker is going to block.
+     */
+    void beginBlocking();
+
+    /**
+     * @brief Method for notifying pool, that current
+     * worker has finished blocking operation.
+     */
+    void endBlocking();
+
+    /**
+     * @brief Method for counting blocked worker and
+     * spawning compensating worker if it's required.
+     */
+    void addBlockedWorker();
+
+    /**
+     * @brief Method for uncounting blocked worker.
+     * Extra compensating worker retires.
+     */
+    void removeBlockedWorker();
+
+    /**
+     * @brief Method for joining retired
+     * compensating workers.
+     */
+    void reapCompensatingWorkers();
+
+    /**
+     * @brief Method for stopping and joining workers
+     * with index not less than threads.
+     * @param lock Locked threads mutex. It's unlocked
+     * while workers are joined.
+     * @param threads Number of workers to keep.
+     */
+    void retireWorkers(std::unique_lock<std::mutex>& lock, uint32_t threads);
+
+    /**
+     * @brief Method for pushing job to submission queue.
+     * Has to be called under jobs mutex.
+     * @param queue Queue.
+     * @param jobContainer Job.
+     */
+    void enqueue(SubmissionQueue& queue, JobContainer jobContainer);
+
+    /**
+     * @brief Method for pushing internal or infinite job
+     * to default queue. If queue is full, job is spilled
+     * and moved to queue as soon as there is free space.
+     * Has to be called under jobs mutex.
+     * @param jobContainer Job.
+     */
+    void enqueueInternal(JobContainer jobContainer);
+
+    /**
+     * @brief Method for adding job to submission queue
+     * with specified overflow policy.
+     * @param queue Queue index.
+     * @param job Job.
+     * @param policy Overflow policy.
+     * @param waitUntil Time limit for OverflowPolicy::Block.
+     * @return Job result.
+     */
+    JobResult submit(QueueIndex queue,
+                     Job job,
+                     OverflowPolicy policy,
+                     Clock::time_point waitUntil);
+
+    /**
+     * @brief Method for adding prepared job to submission
+     * queue with specified overflow policy.
+     * @param queue Queue index.
+     * @param jobContainer Job.
+     * @param policy Overflow policy.
+     * @param waitUntil Time limit for OverflowPolicy::Block.
+     * @return False if there is no such queue.
+     */
+    bool submit(QueueIndex queue,
+                JobContainer& jobContainer,
+                OverflowPolicy policy,
+                Clock::time_point waitUntil);
+
+    /**
+     * @brief Method for rejecting job.
+     * @param jobContainer Job.
+     */
+    void reject(JobContainer jobContainer);
+
+    /**
+     * @brief Method for delivering job result to
+     * JobResult or completion queue.
+     * @param jobContainer Job.
+     * @param result Result.
+     */
+    void complete(JobContainer& jobContainer, Job::Result result);
+
+    /**
+     * @brief Method for finishing job without execution.
+     * @param jobContainer Job.
+     * @param state Final job state.
+     */
+    void cancel(JobContainer& jobContainer, JobResult::State state);
+
+    /**
+     * @brief Method for taking job from next submission
+     * queue. Has to be called under jobs mutex, when
+     * there is at least one queued job.
+     * @return Job.
+     */
+    JobContainer dequeue();
+
+    /**
+     * @brief Method for taking next job to execute.
+     * Sleeps until job will be available.
+     * @tparam Predicate Function, that's checked under
+     * jobs mutex and returns false if worker has to stop.
+     * @param jobContainer Taken job.
+     * @param running Predicate.
+     * @return False if worker has to stop.
+     */
+    template<typename Predicate>
+    bool takeJob(JobContainer& jobContainer, Predicate running);
+
+    /**
+     * @brief Method, that's called by keyed job
+     * after execution. Moves job result from running
+     * jobs to cache.
+     * @param key Job key.
+     */
+    void finishKeyedJob(const std::string& key);
+
+    /**
+     * @brief Method for appending infinite job to
+     * run list. Has to be called under jobs mutex.
+     * @param infiniteJob Infinite job.
+     */
+    void linkInfiniteJob(InfiniteJob* infiniteJob);
+
+    /**
+     * @brief Method for removing infinite job from
+     * run list. Has to be called under jobs mutex.
+     * @param infiniteJob Infinite job.
+     */
+    void unlinkInfiniteJob(InfiniteJob* infiniteJob);
+
+    /**
+     * @brief Method for moving infinite jobs, which
+     * interval has passed, to run list. Has to be
+     * called under jobs mutex.
+     * @param now Current time.
+     */
+    void wakeInfiniteJobs(Clock::time_point now);
+
+    /**
+     * @brief Method for executing infinite job
+     * and returning it to run list or timers heap.
+     * @param infiniteJob Infinite job.
+     */
+    void executeInfiniteJob(InfiniteJob* infiniteJob);
+
+    /**
+     * @brief Method for executing triggered job.
+     * @param jobContainer Queued placeholder of job.
+     */
+    void executeTriggeredJob(JobContainer& jobContainer);
+
+    /**
+     * @brief Method for executing taken job.
+     * @param jobContainer Job.
+     */
+    void executeJob(JobContainer& jobContainer);
+
+    /**
+     * @brief Method for destroying worker local values
+     * of current thread.
+     * @param index Worker index or -1 for compensating worker.
+     */
+    void retireWorkerLocals(int index);
+
+    /**
+     * @brief Watchdog thread job.
+     */
+    void watchdogThread();
+
+    /**
+     * @brief Compensating workers threads job.
+     * @param self Iterator to own container.
+     */
+    void compensatingWorkerThread(std::list<CompensatingThread>::iterator self);
+
+    /**
+     * @brief Method for registering worker local storage.
+     * Storage will be notified about retired workers.
+     * @param local Pointer to storage.
+     */
+    void registerWorkerLocal(WorkerLocalBase* local);
+
+    /**
+     * @brief Method for unregistering worker local storage.
+     * @param local Pointer to storage.
+     */
+    void unregisterWorkerLocal(WorkerLocalBase* local);
+
+    /**
+     * @brief Method for getting next unique job index.
+     * @return Job index.
+     */
+    Job::Index nextIndex();
+
+    /**
+     * @brief Method for adding internal job, that has
+     * no result object. Job result is dropped.
+     * Used by helpers to schedule their own work on
+     * pool workers.
+     * @param job Job.
+     */
+    void post(Job job);
+
     /**
      * @brief Workers threads job.
      * @param index Index in m_threadContainer.
+     * @param container Worker slot.
      */
-    void workerThread(int index);
+    void workerThread(int index, ThreadContainer& container);
 
-    std::vector<ThreadContainer> m_threadContainer;
-    mutable std::shared_mutex m_threadMutex;
+    std::shared_ptr<ThreadFactory> m_threadFactory;
 
-    JobsContainer m_jobs;
+    std::vector<std::unique_ptr<ThreadContainer>> m_threadContainer;
+    mutable std::mutex m_threadMutex;
+    std::mutex m_resizeMutex;
+
+    std::vector<std::unique_ptr<SubmissionQueue>> m_queues;
+    std::size_t m_queuedJobs;
+    QueueIndex m_currentQueue;
+    std::deque<JobContainer> m_spilledJobs;
+
+    std::atomic<OverflowPolicy> m_overflowPolicy;
+    RejectionHandler m_rejectionHandler;
+    uint32_t m_waitingSubmitters;
+    std::condition_variable m_spaceCondition;
+    std::atomic<uint64_t> m_rejectedJobs;
+    std::atomic<uint64_t> m_overflowedJobs;
     std::condition_variable_any m_jobsCondition;
     mutable std::mutex m_jobsMutex;
 
+    // Guarded by m_jobsMutex
+    std::unordered_map<Job::Index, std::shared_ptr<TriggeredJob>> m_triggeredJobs;
+
+    // Guarded by m_jobsMutex
+    std::unordered_map<Job::Index, std::unique_ptr<InfiniteJob>> m_infiniteJobs;
+    InfiniteJob* m_infiniteHead;
+    InfiniteJob* m_infiniteTail;
+    std::vector<InfiniteJob*> m_infiniteTimers;
+    bool m_infiniteTurn; //< Next job is taken from run list
+
+    /**
+     * @brief Cached result of keyed job.
+     */
+    struct CachedResult
+    {
+        std::string key;
+        JobResult result;
+        Clock::time_point expires;
+    };
+
+    std::unordered_map<std::string, JobResult> m_keyedJobs;
+    std::list<CachedResult> m_cachedResults; //< Most recent first
+    std::unordered_map<std::string, std::list<CachedResult>::iterator> m_cachedResultsIndex;
+    std::size_t m_cacheCapacity;
+    Clock::duration m_cacheTtl;
+    std::atomic<uint64_t> m_deduplicatedJobs;
+    std::mutex m_keyedJobsMutex;
+
+    // Guarded by m_jobsMutex
     std::vector<Job::Index> m_removedJobs;
-    mutable std::mutex m_removedJobsMutex;
 
-    Job::Index m_indexCounter;
-    std::mutex m_indexMutex;
+    std::atomic<Job::Index> m_indexCounter;
+
+    std::atomic<uint64_t> m_expiredJobs;
+
+    std::vector<WorkerLocalBase*> m_workerLocals;
+    std::mutex m_workerLocalsMutex;
+
+    // Guarded by m_jobsMutex
+    uint32_t m_blockedWorkers;
+    uint32_t m_compensatingWorkers;
+    uint32_t m_maxCompensatingWorkers;
+
+    std::list<CompensatingThread> m_compensatingThreads;
+    std::mutex m_compensatingThreadsMutex;
+
+    std::thread m_watchdogThread;
+    std::atomic_bool m_watchdogEnabled;
+    bool m_watchdogStop;
+    Clock::duration m_watchdogThreshold;
+    StallHandler m_stallHandler;
+    bool m_replaceStalled;
+    std::atomic<uint64_t> m_stalledJobs;
+    std::condition_variable m_watchdogCondition;
+    std::mutex m_watchdogMutex;
 };
 
@@ -0,0 +1,320 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Base class for worker local storages.
+ * Used by thread pool to notify storage about
+ * retired workers.
+ */
+class WorkerLocalBase
+{
+    friend class ThreadPool;
+
+public:
+    /**
+     * @brief Virtual destructor.
+     */
+    virtual ~WorkerLocalBase() = default;
+
+protected:
+    /**
+     * @brief Method, that's called by worker
+     * thread, when it's retiring.
+     * @param index Worker index or -1 if it's
+     * compensating worker.
+     */
+    virtual void retire(int index) = 0;
+
+    /**
+     * @brief Method for getting unique storage
+     * identifier. Identifiers are never reused, so
+     * cached pointers of destroyed storage can't
+     * match new one.
+     * @return Identifier.
+     */
+    static uint64_t nextIdentifier()
+    {
+        static std::atomic<uint64_t> counter(1);
+        return counter.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Class, that describes storage with one
+ * instance of value per pool worker. Values are
+ * created lazily at first access from worker
+ * and destroyed when worker retires. Every value
+ * is placed at own cache line. Threads, that
+ * are not regular workers of this pool (compensating
+ * workers or workers of other pools for example)
+ * get own values too. Every thread caches pointer
+ * to it's value, so repeated access doesn't lock.
+ * Storage has to be destroyed before thread pool.
+ * @tparam T Value type.
+ */
+template<typename T>
+class WorkerLocal : public WorkerLocalBase
+{
+public:
+
+    using Factory = std::function<T()>;
+
+    /**
+     * @brief Constructor. Values will be
+     * default constructed.
+     * @param pool Thread pool.
+     */
+    explicit WorkerLocal(ThreadPool& pool) :
+        WorkerLocal(pool, [](){ return T(); })
+    {
+
+    }
+
+    /**
+     * @brief Constructor.
+     * @param pool Thread pool.
+     * @param factory Function for creating values.
+     */
+    WorkerLocal(ThreadPool& pool, Factory factory) :
+        m_pool(pool),
+        m_identifier(nextIdentifier()),
+        m_factory(std::move(factory)),
+        m_slots(),
+        m_foreignSlots(),
+        m_mutex()
+    {
+        m_pool.registerWorkerLocal(this);
+    }
+
+    /**
+     * @brief Destructor. Destroys all values.
+     */
+    ~WorkerLocal() override
+    {
+        m_pool.unregisterWorkerLocal(this);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        for (auto&& slot : m_slots)
+        {
+            destroy(slot);
+        }
+
+        for (auto&& slot : m_foreignSlots)
+        {
+            destroy(slot.second);
+        }
+    }
+
+    WorkerLocal(const WorkerLocal&) = delete;
+    WorkerLocal& operator=(const WorkerLocal&) = delete;
+
+    /**
+     * @brief Method for getting value of current
+     * worker. Value will be created if it's
+     * first access from this worker.
+     * @return Reference to value.
+     */
+    T& local()
+    {
+        // Slot is modified only by it's own
+        // thread, so cached slot is checked
+        // without lock
+        auto& cache = threadCache();
+
+        for (std::size_t i = 0; i < Cache::Size; ++i)
+        {
+            if (cache.identifiers[i] == m_identifier &&
+                cache.slots[i]->constructed)
+            {
+                return cache.slots[i]->value();
+            }
+        }
+
+        auto index = m_pool.workerIndex();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (index >= 0 && m_slots.size() <= static_cast<std::size_t>(index))
+        {
+            m_slots.resize(index + 1);
+        }
+
+        auto& slot = index >= 0 ?
+                     m_slots[index] :
+                     m_foreignSlots[std::this_thread::get_id()];
+
+        if (!slot)
+        {
+            slot.reset(new Slot());
+        }
+
+        if (!slot->constructed)
+        {
+            new (&slot->storage) T(m_factory());
+            slot->constructed = true;
+        }
+
+        cache.insert(m_identifier, slot.get());
+
+        return slot->value();
+    }
+
+    /**
+     * @brief Method for iterating over all
+     * created values. Can be used for
+     * reductions.
+     * @tparam F Function type.
+     * @param function Function, that takes
+     * reference to value.
+     */
+    template<typename F>
+    void forEach(F function)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        for (auto&& slot : m_slots)
+        {
+            if (slot && slot->constructed)
+            {
+                function(slot->value());
+            }
+        }
+
+        for (auto&& slot : m_foreignSlots)
+        {
+            if (slot.second->constructed)
+            {
+                function(slot.second->value());
+            }
+        }
+    }
+
+protected:
+
+    void retire(int index) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // Retire is called by retiring thread
+        threadCache().erase(m_identifier);
+
+        if (index < 0)
+        {
+            auto iterator = m_foreignSlots.find(std::this_thread::get_id());
+
+            if (iterator != m_foreignSlots.end())
+            {
+                destroy(iterator->second);
+                m_foreignSlots.erase(iterator);
+            }
+        }
+        else if (static_cast<std::size_t>(index) < m_slots.size())
+        {
+            destroy(m_slots[index]);
+        }
+    }
+
+private:
+
+    /**
+     * @brief Storage of single worker value.
+     */
+    struct alignas(ThreadPool::CacheLineSize) Slot
+    {
+        Slot() :
+            storage(),
+            constructed(false)
+        {}
+
+        T& value()
+        {
+            return *reinterpret_cast<T*>(&storage);
+        }
+
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        bool constructed;
+    };
+
+    /**
+     * @brief Slots of storages with value type T,
+     * that were accessed by thread last. Several
+     * storages of same type don't evict each other
+     * until there are more of them than entries.
+     */
+    struct Cache
+    {
+        static const std::size_t Size = 8;
+
+        void insert(uint64_t identifier, Slot* slot)
+        {
+            erase(identifier);
+
+            identifiers[next] = identifier;
+            slots[next] = slot;
+
+            next = (next + 1) % Size;
+        }
+
+        void erase(uint64_t identifier)
+        {
+            for (std::size_t i = 0; i < Size; ++i)
+            {
+                if (identifiers[i] == identifier)
+                {
+                    identifiers[i] = 0;
+                    slots[i] = nullptr;
+                }
+            }
+        }
+
+        uint64_t identifiers[Size] = {};
+        Slot* slots[Size] = {};
+        std::size_t next = 0; //< Entry to replace
+    };
+
+    /**
+     * @brief Method for getting cache of
+     * current thread.
+     * @return Reference to cache.
+     */
+    static Cache& threadCache()
+    {
+        static thread_local Cache cache;
+        return cache;
+    }
+
+    void destroy(std::unique_ptr<Slot>& slot)
+    {
+        if (slot && slot->constructed)
+        {
+            slot->value().~T();
+            slot->constructed = false;
+        }
+    }
+
+    ThreadPool& m_pool;
+    uint64_t m_identifier;
+    Factory m_factory;
+
+    // Slots are never freed before storage
+    // destruction, except foreign ones, that
+    // are freed by own thread
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::unordered_map<std::thread::id, std::unique_ptr<Slot>> m_foreignSlots;
+    std::mutex m_mutex;
+};
+
@@ -0,0 +1,77 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include <utility>
+#include <algorithm>
+
+#include "CompletionQueue.hpp"
+
+CompletionQueue::CompletionQueue() :
+    m_completions(),
+    m_condition(),
+    m_mutex()
+{
+
+}
+
+std::optional<CompletionQueue::Completion> CompletionQueue::poll()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_completions.empty())
+    {
+        return std::nullopt;
+    }
+
+    auto completion = std::move(m_completions.front());
+    m_completions.pop_front();
+
+    return completion;
+}
+
+CompletionQueue::Completion CompletionQueue::waitOne()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_completions.empty())
+    {
+        m_condition.wait(lock);
+    }
+
+    auto completion = std::move(m_completions.front());
+    m_completions.pop_front();
+
+    return completion;
+}
+
+std::vector<CompletionQueue::Completion> CompletionQueue::drain(std::size_t count)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    count = std::min(count, m_completions.size());
+
+    std::vector<Completion> completions(
+        std::make_move_iterator(m_completions.begin()),
+        std::make_move_iterator(m_completions.begin() + count)
+    );
+
+    m_completions.erase(m_completions.begin(), m_completions.begin() + count);
+
+    return completions;
+}
+
+std::size_t CompletionQueue::size() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_completions.size();
+}
+
+void CompletionQueue::push(CompletionQueue::Completion completion)
+{
+    // Notifying under lock, consumer may destroy
+    // queue right after it takes last completion
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_completions.push_back(std::move(completion));
+    m_condition.notify_one();
+}
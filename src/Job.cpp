@@ -30,7 +30,7 @@ void Job::setIndex(Job::Index index)
     m_index = index;
 }
 
-Job::FunctionType Job::function() const
+const Job::FunctionType& Job::function() const
 {
     return m_function;
 }
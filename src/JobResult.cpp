@@ -21,7 +21,7 @@ JobResult::JobResult(const Job& job) :
 JobResult::Implementation::Implementation(const Job& job) :
     m_job(job),
     m_data(nullptr),
-    m_resultReceived(false),
+    m_state(State::Pending),
     m_conditionVariable(),
     m_mutex()
 {
@@ -31,7 +31,7 @@ JobResult::Implementation::Implementation(const Job& job) :
 JobResult::Implementation::Implementation() :
     m_job(),
     m_data(nullptr),
-    m_resultReceived(false),
+    m_state(State::Pending),
     m_conditionVariable(),
     m_mutex()
 {
@@ -43,14 +43,27 @@ void JobResult::Implementation::set(std::shared_ptr<void> data)
     std::unique_lock<std::mutex> lock(m_mutex);
     m_data = std::move(data);
     m_conditionVariable.notify_all();
-    m_resultReceived = true;
+    m_state = State::Finished;
+}
+
+void JobResult::Implementation::finish(JobResult::State state)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_conditionVariable.notify_all();
+    m_state = state;
+}
+
+JobResult::State JobResult::Implementation::state() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_state;
 }
 
 void JobResult::Implementation::waitForResult()
 {
     std::unique_lock<std::mutex> lock(m_mutex);
 
-    while (!m_resultReceived)
+    while (m_state == State::Pending)
     {
         m_conditionVariable.wait(lock);
     }
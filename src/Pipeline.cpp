@@ -0,0 +1,195 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include <utility>
+#include <algorithm>
+
+#include "Pipeline.hpp"
+#include "ThreadPool.hpp"
+
+Pipeline::Pipeline(ThreadPool& pool, Pipeline::InputFunction input) :
+    m_pool(pool),
+    m_input(std::move(input)),
+    m_inputDone(false),
+    m_inputSequence(0),
+    m_inputMutex(),
+    m_stages(),
+    m_activeSlots(0),
+    m_finishedCondition(),
+    m_mutex()
+{
+
+}
+
+Pipeline& Pipeline::addStage(Pipeline::Mode mode, Pipeline::StageFunction function)
+{
+    m_stages.emplace_back(new Stage(mode, std::move(function)));
+    return *this;
+}
+
+void Pipeline::run(std::size_t maxTokens)
+{
+    maxTokens = std::max<std::size_t>(maxTokens, 1);
+
+    m_inputDone = false;
+    m_inputSequence = 0;
+
+    for (auto&& stage : m_stages)
+    {
+        stage->nextSequence = 0;
+    }
+
+    m_activeSlots = maxTokens;
+
+    for (std::size_t i = 0; i < maxTokens; ++i)
+    {
+        m_pool.post(Job(
+            [this]() -> Job::Result
+            {
+                startSlot();
+                return nullptr;
+            }
+        ));
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_activeSlots != 0)
+    {
+        m_finishedCondition.wait(lock);
+    }
+}
+
+bool Pipeline::readInput(Pipeline::Token& token)
+{
+    std::unique_lock<std::mutex> lock(m_inputMutex);
+
+    if (m_inputDone)
+    {
+        return false;
+    }
+
+    token.item = m_input();
+
+    if (!token.item)
+    {
+        m_inputDone = true;
+        return false;
+    }
+
+    token.sequence = m_inputSequence++;
+
+    return true;
+}
+
+void Pipeline::startSlot()
+{
+    Token token;
+
+    if (!readInput(token))
+    {
+        finishSlot();
+        return;
+    }
+
+    drive(std::move(token), 0, false);
+}
+
+void Pipeline::drive(Pipeline::Token token, std::size_t stage, bool claimed)
+{
+    do
+    {
+        if (!advance(token, stage, claimed))
+        {
+            // Token is parked. It will be resumed
+            // by the token, that's holding stage.
+            return;
+        }
+
+        stage = 0;
+        claimed = false;
+    } while (readInput(token));
+
+    finishSlot();
+}
+
+bool Pipeline::advance(Pipeline::Token& token, std::size_t stage, bool claimed)
+{
+    for (; stage < m_stages.size(); ++stage, claimed = false)
+    {
+        auto& current = *m_stages[stage];
+
+        if (current.mode == Mode::Parallel)
+        {
+            token.item = current.function(std::move(token.item));
+            continue;
+        }
+
+        if (!claimed)
+        {
+            std::unique_lock<std::mutex> lock(current.mutex);
+
+            if (current.busy ||
+                (current.mode == Mode::SerialInOrder &&
+                 token.sequence != current.nextSequence))
+            {
+                current.waiting.emplace(token.sequence, std::move(token));
+                return false;
+            }
+
+            current.busy = true;
+        }
+
+        token.item = current.function(std::move(token.item));
+
+        release(stage);
+    }
+
+    return true;
+}
+
+void Pipeline::release(std::size_t stage)
+{
+    auto& current = *m_stages[stage];
+
+    Token next;
+
+    {
+        std::unique_lock<std::mutex> lock(current.mutex);
+
+        ++current.nextSequence;
+
+        auto iterator = current.mode == Mode::SerialInOrder ?
+                        current.waiting.find(current.nextSequence) :
+                        current.waiting.begin();
+
+        if (iterator == current.waiting.end())
+        {
+            current.busy = false;
+            return;
+        }
+
+        // Stage stays busy and is handed to next token
+        next = std::move(iterator->second);
+        current.waiting.erase(iterator);
+    }
+
+    m_pool.post(Job(
+        [this, next, stage]() mutable -> Job::Result
+        {
+            drive(std::move(next), stage, true);
+            return nullptr;
+        }
+    ));
+}
+
+void Pipeline::finishSlot()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (--m_activeSlots == 0)
+    {
+        m_finishedCondition.notify_all();
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include <utility>
+
+#include "Strand.hpp"
+#include "ThreadPool.hpp"
+
+Strand::Strand(ThreadPool& pool) :
+    m_pool(pool),
+    m_jobs(),
+    m_scheduled(false),
+    m_idleCondition(),
+    m_mutex()
+{
+
+}
+
+Strand::~Strand()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_scheduled)
+    {
+        m_idleCondition.wait(lock);
+    }
+}
+
+JobResult Strand::addJob(Job job)
+{
+    job.setIndex(m_pool.nextIndex());
+
+    auto result = JobResult(job);
+
+    bool schedule = false;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobs.push_back({std::move(job), result});
+
+        if (!m_scheduled)
+        {
+            m_scheduled = true;
+            schedule = true;
+        }
+    }
+
+    // Only the first job of idle strand
+    // goes through pool queue
+    if (schedule)
+    {
+        m_pool.post(Job(
+            [this]() -> Job::Result
+            {
+                drain();
+                return nullptr;
+            }
+        ));
+    }
+
+    return result;
+}
+
+void Strand::drain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (std::size_t executed = 0;
+         executed < MaxBatch && !m_jobs.empty();
+         ++executed)
+    {
+        auto container = std::move(m_jobs.front());
+        m_jobs.pop_front();
+
+        lock.unlock();
+
+        container.result.m_impl->set(container.job.function()());
+
+        lock.lock();
+    }
+
+    if (m_jobs.empty())
+    {
+        m_scheduled = false;
+        m_idleCondition.notify_all();
+        return;
+    }
+
+    lock.unlock();
+
+    // Batch is over, giving worker back to
+    // other pool jobs
+    m_pool.post(Job(
+        [this]() -> Job::Result
+        {
+            drain();
+            return nullptr;
+        }
+    ));
+}
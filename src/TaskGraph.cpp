@@ -0,0 +1,194 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include <utility>
+
+#include "TaskGraph.hpp"
+#include "ThreadPool.hpp"
+
+TaskGraph::TaskGraph() :
+    m_nodes(),
+    m_roots(),
+    m_valid(false),
+    m_pool(nullptr),
+    m_remaining(0),
+    m_finished(false),
+    m_finishedCondition(),
+    m_mutex()
+{
+
+}
+
+TaskGraph::Node TaskGraph::addNode(TaskGraph::FunctionType function)
+{
+    m_valid = false;
+    m_nodes.emplace_back(new NodeContainer(std::move(function)));
+    return static_cast<Node>(m_nodes.size() - 1);
+}
+
+void TaskGraph::precede(TaskGraph::Node from, TaskGraph::Node to)
+{
+    if (from >= m_nodes.size() ||
+        to >= m_nodes.size())
+    {
+        return;
+    }
+
+    m_valid = false;
+    m_nodes[from]->successors.push_back(to);
+    ++m_nodes[to]->predecessors;
+}
+
+bool TaskGraph::validate()
+{
+    m_roots.clear();
+
+    // Kahn's algorithm
+    std::vector<uint32_t> predecessors(m_nodes.size());
+    std::vector<Node> ready;
+
+    for (Node node = 0; node < m_nodes.size(); ++node)
+    {
+        predecessors[node] = m_nodes[node]->predecessors;
+
+        if (predecessors[node] == 0)
+        {
+            m_roots.push_back(node);
+            ready.push_back(node);
+        }
+    }
+
+    std::size_t visited = 0;
+
+    while (!ready.empty())
+    {
+        auto node = ready.back();
+        ready.pop_back();
+
+        ++visited;
+
+        for (auto successor : m_nodes[node]->successors)
+        {
+            if (--predecessors[successor] == 0)
+            {
+                ready.push_back(successor);
+            }
+        }
+    }
+
+    m_valid = visited == m_nodes.size();
+
+    return m_valid;
+}
+
+bool TaskGraph::isValid() const
+{
+    return m_valid;
+}
+
+std::size_t TaskGraph::size() const
+{
+    return m_nodes.size();
+}
+
+bool TaskGraph::run(ThreadPool& pool)
+{
+    if (!m_valid)
+    {
+        return false;
+    }
+
+    if (m_nodes.empty())
+    {
+        return true;
+    }
+
+    m_pool = &pool;
+
+    for (auto&& node : m_nodes)
+    {
+        node->pending.store(node->predecessors, std::memory_order_relaxed);
+    }
+
+    m_remaining.store(m_nodes.size());
+    m_finished = false;
+
+    for (auto root : m_roots)
+    {
+        schedule(root);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (!m_finished)
+    {
+        m_finishedCondition.wait(lock);
+    }
+
+    return true;
+}
+
+void TaskGraph::schedule(TaskGraph::Node node)
+{
+    // Capture fits into std::function small
+    // buffer, so scheduling does not allocate
+    m_pool->post(Job(
+        [this, node]() -> Job::Result
+        {
+            execute(node);
+            return nullptr;
+        }
+    ));
+}
+
+void TaskGraph::execute(TaskGraph::Node node)
+{
+    while (true)
+    {
+        auto& container = *m_nodes[node];
+
+        container.function();
+
+        // First ready successor is executed by this
+        // worker, others are scheduled
+        auto next = static_cast<Node>(m_nodes.size());
+
+        for (auto successor : container.successors)
+        {
+            if (m_nodes[successor]->pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                continue;
+            }
+
+            if (next == m_nodes.size())
+            {
+                next = successor;
+            }
+            else
+            {
+                schedule(successor);
+            }
+        }
+
+        // Graph may be destroyed right after last
+        // node is finished, so it's not touched
+        // after decrement
+        bool hasNext = next != m_nodes.size();
+
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_finished = true;
+            m_finishedCondition.notify_all();
+            return;
+        }
+
+        if (!hasNext)
+        {
+            return;
+        }
+
+        node = next;
+    }
+}
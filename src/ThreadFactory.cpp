@@ -0,0 +1,196 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include <utility>
+#include <memory>
+#include <system_error>
+#include <exception>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ThreadFactory.hpp"
+
+ThreadFactory::Thread::Thread() :
+    m_handle(),
+    m_joinable(false)
+{
+
+}
+
+ThreadFactory::Thread::~Thread()
+{
+    // Thread would be leaked
+    if (m_joinable)
+    {
+        std::terminate();
+    }
+}
+
+ThreadFactory::Thread::Thread(Thread&& rhs) noexcept :
+    m_handle(rhs.m_handle),
+    m_joinable(rhs.m_joinable)
+{
+    rhs.m_joinable = false;
+}
+
+ThreadFactory::Thread& ThreadFactory::Thread::operator=(Thread&& rhs) noexcept
+{
+    if (m_joinable)
+    {
+        std::terminate();
+    }
+
+    m_handle = rhs.m_handle;
+    m_joinable = rhs.m_joinable;
+    rhs.m_joinable = false;
+
+    return *this;
+}
+
+bool ThreadFactory::Thread::joinable() const
+{
+    return m_joinable;
+}
+
+void ThreadFactory::Thread::join()
+{
+    if (m_joinable)
+    {
+        pthread_join(m_handle, nullptr);
+        m_joinable = false;
+    }
+}
+
+ThreadFactory::ThreadFactory() :
+    m_options()
+{
+
+}
+
+ThreadFactory::ThreadFactory(ThreadFactory::Options options) :
+    m_options(std::move(options))
+{
+
+}
+
+const ThreadFactory::Options& ThreadFactory::options() const
+{
+    return m_options;
+}
+
+ThreadFactory::Thread ThreadFactory::create(int index, std::function<void()> body)
+{
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+
+    if (m_options.stackSize != 0)
+    {
+        // Too small stack would be silently
+        // replaced with default one
+        auto error = pthread_attr_setstacksize(&attributes, m_options.stackSize);
+
+        if (error != 0)
+        {
+            pthread_attr_destroy(&attributes);
+            throw std::system_error(error, std::generic_category(), "pthread_attr_setstacksize");
+        }
+    }
+
+    std::unique_ptr<StartData> data(new StartData{
+        this,
+        index,
+        std::move(body)
+    });
+
+    pthread_t handle;
+
+    auto error = pthread_create(
+        &handle,
+        &attributes,
+        &ThreadFactory::start,
+        data.get()
+    );
+
+    pthread_attr_destroy(&attributes);
+
+    if (error != 0)
+    {
+        throw std::system_error(error, std::generic_category(), "pthread_create");
+    }
+
+    // Now it's owned by thread
+    data.release();
+
+    return adopt(handle);
+}
+
+ThreadFactory::Thread ThreadFactory::adopt(pthread_t handle)
+{
+    Thread thread;
+
+    thread.m_handle = handle;
+    thread.m_joinable = true;
+
+    return thread;
+}
+
+void* ThreadFactory::start(void* argument)
+{
+    std::unique_ptr<StartData> data(static_cast<StartData*>(argument));
+
+    data->factory->run(data->index, data->body);
+
+    return nullptr;
+}
+
+void ThreadFactory::run(int index, const std::function<void()>& body) const
+{
+    setup(index);
+
+    if (m_options.onStart)
+    {
+        m_options.onStart(index);
+    }
+
+    body();
+
+    if (m_options.onStop)
+    {
+        m_options.onStop(index);
+    }
+}
+
+void ThreadFactory::setup(int index) const
+{
+    if (!m_options.name.empty())
+    {
+        auto name = m_options.name + "/" + (index < 0 ? std::string("+") : std::to_string(index));
+
+        // Linux limit is 16 bytes with terminating zero
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    }
+
+    if (m_options.niceValue != 0)
+    {
+        // On Linux nice value is per thread
+        setpriority(
+            PRIO_PROCESS,
+            static_cast<id_t>(syscall(SYS_gettid)),
+            m_options.niceValue
+        );
+    }
+
+    if (m_options.schedulingPolicy != SCHED_OTHER)
+    {
+        sched_param parameters{};
+        parameters.sched_priority = m_options.schedulingPriority;
+
+        pthread_setschedparam(
+            pthread_self(),
+            m_options.schedulingPolicy,
+            &parameters
+        );
+    }
+}
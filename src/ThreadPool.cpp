@@ -5,224 +5,1650 @@
 #include <utility>
 #include <algorithm>
 #include <iostream>
+#include <system_error>
 
 #include "ThreadPool.hpp"
+#include "WorkerLocal.hpp"
+#include "CompletionQueue.hpp"
+
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local int currentWorker = -1;
 
 ThreadPool::ThreadPool(uint32_t threads) :
+    ThreadPool(threads, std::make_shared<ThreadFactory>())
+{
+
+}
+
+ThreadPool::ThreadPool(uint32_t threads, std::shared_ptr<ThreadFactory> factory) :
+    m_threadFactory(std::move(factory)),
     m_threadContainer(),
     m_threadMutex(),
-    m_jobs(),
+    m_resizeMutex(),
+    m_queues(),
+    m_queuedJobs(0),
+    m_currentQueue(DefaultQueue),
+    m_spilledJobs(),
+    m_overflowPolicy(OverflowPolicy::Block),
+    m_rejectionHandler(),
+    m_waitingSubmitters(0),
+    m_spaceCondition(),
+    m_rejectedJobs(0),
+    m_overflowedJobs(0),
     m_jobsCondition(),
     m_jobsMutex(),
+    m_triggeredJobs(),
+    m_infiniteJobs(),
+    m_infiniteHead(nullptr),
+    m_infiniteTail(nullptr),
+    m_infiniteTimers(),
+    m_infiniteTurn(false),
+    m_keyedJobs(),
+    m_cachedResults(),
+    m_cachedResultsIndex(),
+    m_cacheCapacity(0),
+    m_cacheTtl(),
+    m_deduplicatedJobs(0),
+    m_keyedJobsMutex(),
     m_removedJobs(),
-    m_removedJobsMutex(),
     m_indexCounter(1),
-    m_indexMutex()
+    m_expiredJobs(0),
+    m_workerLocals(),
+    m_workerLocalsMutex(),
+    m_blockedWorkers(0),
+    m_compensatingWorkers(0),
+    m_maxCompensatingWorkers(DefaultMaxCompensatingWorkers),
+    m_compensatingThreads(),
+    m_compensatingThreadsMutex(),
+    m_watchdogThread(),
+    m_watchdogEnabled(false),
+    m_watchdogStop(false),
+    m_watchdogThreshold(),
+    m_stallHandler(),
+    m_replaceStalled(false),
+    m_stalledJobs(0),
+    m_watchdogCondition(),
+    m_watchdogMutex()
 {
+    m_queues.emplace_back(new SubmissionQueue("default", 1));
+
     changeNumberOfThreads(threads);
 }
 
 ThreadPool::~ThreadPool()
 {
+    disableWatchdog();
+
     changeNumberOfThreads(0);
+
+    // Blocking regions are finished with workers,
+    // so compensating workers are retiring now.
+    // Containers are kept until the end, because
+    // threads are marking them as finished.
+    while (true)
+    {
+        std::vector<ThreadFactory::Thread> threads;
+
+        {
+            std::unique_lock<std::mutex> lock(m_compensatingThreadsMutex);
+
+            for (auto&& compensating : m_compensatingThreads)
+            {
+                if (compensating.thread.joinable())
+                {
+                    threads.push_back(std::move(compensating.thread));
+                }
+            }
+        }
+
+        if (threads.empty())
+        {
+            break;
+        }
+
+        for (auto&& thread : threads)
+        {
+            thread.join();
+        }
+    }
 }
 
 void ThreadPool::changeNumberOfThreads(uint32_t threads)
 {
-    std::unique_lock<std::shared_mutex> lock(m_threadMutex);
+    // Retiring workers have to finish before
+    // their indices will be reused
+    std::unique_lock<std::mutex> resizeLock(m_resizeMutex);
+    std::unique_lock<std::mutex> lock(m_threadMutex);
     if (m_threadContainer.size()  > threads)
     {
-        // Removing threads
-        auto difference = m_threadContainer.size() - threads;
+        retireWorkers(lock, threads);
+    }
+    else if (m_threadContainer.size() < threads)
+    {
+        // Adding new threads
+        auto previous = m_threadContainer.size();
+        auto difference = threads - previous;
 
-        // Disabling threads
-        for (decltype(difference) i = 0;
-             i < difference;
-             ++i)
+        try
         {
-            m_threadContainer[m_threadContainer.size() - i - 1].running = false;
-        }
+            for (decltype(difference) i = 0;
+                 i < difference;
+                 ++i)
+            {
+                auto index = static_cast<int>(m_threadContainer.size());
 
-        m_jobsCondition.notify_all();
+                std::unique_ptr<ThreadContainer> container(new ThreadContainer());
+                auto pointer = container.get();
 
-        // Waiting for threads to end
-        lock.unlock();
+                container->thread = m_threadFactory->create(
+                    index,
+                    [this, index, pointer]()
+                    {
+                        workerThread(index, *pointer);
+                    }
+                );
 
-        for (decltype(difference) i = 0;
-             i < difference;
-             ++i)
-        {
-            if (m_threadContainer[m_threadContainer.size() - i - 1].thread.joinable())
-            {
-                m_threadContainer[m_threadContainer.size() - i - 1].thread.join();
+                m_threadContainer.push_back(std::move(container));
             }
         }
+        catch (...)
+        {
+            // Workers, that were started by this call,
+            // must not outlive failed constructor
+            retireWorkers(lock, static_cast<uint32_t>(previous));
+            throw;
+        }
+    }
+}
 
-        lock.lock();
+void ThreadPool::retireWorkers(std::unique_lock<std::mutex>& lock, uint32_t threads)
+{
+    // Slots are taken out of container,
+    // workers keep pointers to them.
+    std::vector<std::unique_ptr<ThreadContainer>> removed(
+        std::make_move_iterator(m_threadContainer.begin() + threads),
+        std::make_move_iterator(m_threadContainer.end())
+    );
 
-        // Removing em
-        m_threadContainer.erase(
-            m_threadContainer.begin() + (m_threadContainer.size() - difference),
-            m_threadContainer.end()
-        );
+    m_threadContainer.erase(
+        m_threadContainer.begin() + threads,
+        m_threadContainer.end()
+    );
+
+    // Disabling threads
+    for (auto&& container : removed)
+    {
+        container->running.store(false, std::memory_order_relaxed);
     }
-    else if (m_threadContainer.size() < threads)
+
+    // Jobs mutex guarantees, that sleeping worker
+    // has checked flag before waiting
     {
-        // Adding new threads
-        auto difference = threads - m_threadContainer.size();
+        std::unique_lock<std::mutex> jobsLock(m_jobsMutex);
+    }
+
+    m_jobsCondition.notify_all();
+
+    // Waiting for threads to end. Workers may
+    // call numberOfThreads, so lock is released.
+    lock.unlock();
 
-        for (decltype(difference) i = 0;
-             i < difference;
-             ++i)
+    for (auto&& container : removed)
+    {
+        if (container->thread.joinable())
         {
-            m_threadContainer.emplace_back(
-                std::thread(&ThreadPool::workerThread, this, m_threadContainer.size())
-            );
+            container->thread.join();
         }
     }
 }
 
 uint32_t ThreadPool::numberOfThreads() const
 {
-    std::shared_lock<std::shared_mutex> lock(m_threadMutex);
+    std::unique_lock<std::mutex> lock(m_threadMutex);
     return static_cast<uint32_t>(m_threadContainer.size());
 }
 
+Job::Index ThreadPool::nextIndex()
+{
+    return m_indexCounter.fetch_add(1, std::memory_order_relaxed);
+}
+
 JobResult ThreadPool::addJob(Job job)
 {
+    return addJob(DefaultQueue, std::move(job));
+}
+
+JobResult ThreadPool::addJob(QueueIndex queue, Job job)
+{
+    return submit(queue, std::move(job), m_overflowPolicy, Clock::time_point::max());
+}
+
+Job::Index ThreadPool::addJob(Job job, CompletionQueue& completionQueue)
+{
+    return addJob(DefaultQueue, std::move(job), completionQueue);
+}
+
+Job::Index ThreadPool::addJob(QueueIndex queue, Job job, CompletionQueue& completionQueue)
+{
+    job.setIndex(nextIndex());
+
+    auto index = job.index();
+
+    JobContainer jobContainer(std::move(job), JobType::Regular);
+    jobContainer.completionQueue = &completionQueue;
 
+    if (!submit(queue, jobContainer, m_overflowPolicy, Clock::time_point::max()))
     {
-        std::unique_lock<std::mutex> lock(m_indexMutex);
-        job.setIndex(m_indexCounter++);
+        return 0;
     }
 
+    return index;
+}
+
+JobResult ThreadPool::tryAddJob(Job job)
+{
+    return tryAddJob(DefaultQueue, std::move(job));
+}
+
+JobResult ThreadPool::tryAddJob(QueueIndex queue, Job job)
+{
+    return submit(queue, std::move(job), OverflowPolicy::Reject, Clock::time_point::max());
+}
+
+JobResult ThreadPool::addJobFor(Job job, Clock::duration timeout)
+{
+    return addJobFor(DefaultQueue, std::move(job), timeout);
+}
+
+JobResult ThreadPool::addJobFor(QueueIndex queue, Job job, Clock::duration timeout)
+{
+    return submit(queue, std::move(job), OverflowPolicy::Block, Clock::now() + timeout);
+}
+
+void ThreadPool::setOverflowPolicy(OverflowPolicy policy)
+{
+    m_overflowPolicy = policy;
+}
+
+void ThreadPool::setRejectionHandler(RejectionHandler handler)
+{
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
+    m_rejectionHandler = std::move(handler);
+}
+
+uint64_t ThreadPool::rejectedJobs() const
+{
+    return m_rejectedJobs.load();
+}
+
+uint64_t ThreadPool::overflowedJobs() const
+{
+    return m_overflowedJobs.load();
+}
+
+JobResult ThreadPool::submit(QueueIndex queue,
+                             Job job,
+                             OverflowPolicy policy,
+                             Clock::time_point waitUntil)
+{
+    job.setIndex(nextIndex());
+
     auto result = JobResult(job);
 
+    JobContainer jobContainer(std::move(job), result);
+
+    if (!submit(queue, jobContainer, policy, waitUntil))
     {
-        std::unique_lock<std::mutex> lock(m_jobsMutex);
-        m_jobs.emplace_back(job, result);
+        // There is no such queue
+        result.m_impl->finish(JobResult::State::Rejected);
     }
 
-    m_jobsCondition.notify_one();
-
     return result;
 }
 
-Job::Index ThreadPool::addInfiniteJob(Job job)
+bool ThreadPool::submit(QueueIndex queue,
+                        JobContainer& jobContainer,
+                        OverflowPolicy policy,
+                        Clock::time_point waitUntil)
 {
+    JobContainer dropped;
+
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+        if (queue >= m_queues.size())
+        {
+            return false;
+        }
+
+        auto& submissionQueue = *m_queues[queue];
+
+        if (submissionQueue.depth() >= MaxElements)
+        {
+            ++m_overflowedJobs;
+
+            // Worker would wait for space, that only
+            // workers can free
+            if (policy == OverflowPolicy::Block &&
+                currentPool == this)
+            {
+                policy = OverflowPolicy::CallerRuns;
+            }
+
+            switch (policy)
+            {
+            case OverflowPolicy::Block:
+                ++m_waitingSubmitters;
+
+                while (submissionQueue.depth() >= MaxElements)
+                {
+                    if (waitUntil == Clock::time_point::max())
+                    {
+                        m_spaceCondition.wait(lock);
+                    }
+                    else if (m_spaceCondition.wait_until(lock, waitUntil) == std::cv_status::timeout)
+                    {
+                        break;
+                    }
+                }
+
+                --m_waitingSubmitters;
+
+                if (submissionQueue.depth() < MaxElements)
+                {
+                    break;
+                }
+
+                // Timeout
+                lock.unlock();
+                reject(std::move(jobContainer));
+                return true;
+
+            case OverflowPolicy::Reject:
+                lock.unlock();
+                reject(std::move(jobContainer));
+                return true;
+
+            case OverflowPolicy::CallerRuns:
+                lock.unlock();
+                complete(jobContainer, jobContainer.job.function()());
+                return true;
+
+            case OverflowPolicy::DropOldest:
+                // Internal jobs can't be dropped, they
+                // are moved to spilled jobs instead
+                while (submissionQueue.depth() >= MaxElements)
+                {
+                    if (submissionQueue.jobs.empty())
+                    {
+                        // Dropping least urgent job. Comparator
+                        // orders heap by descending deadline.
+                        auto latest = std::min_element(
+                            submissionQueue.deadlineJobs.begin(),
+                            submissionQueue.deadlineJobs.end(),
+                            DeadlineComparator()
+                        );
+
+                        std::iter_swap(latest, submissionQueue.deadlineJobs.end() - 1);
+
+                        --m_queuedJobs;
+                        dropped = std::move(submissionQueue.deadlineJobs.back());
+                        submissionQueue.deadlineJobs.pop_back();
+
+                        std::make_heap(
+                            submissionQueue.deadlineJobs.begin(),
+                            submissionQueue.deadlineJobs.end(),
+                            DeadlineComparator()
+                        );
+                        continue;
+                    }
+
+                    auto oldest = std::move(submissionQueue.jobs.front());
+                    submissionQueue.jobs.pop_front();
+
+                    if (!oldest.isInternal())
+                    {
+                        --m_queuedJobs;
+                        dropped = std::move(oldest);
+                    }
+                    else
+                    {
+                        m_spilledJobs.push_back(std::move(oldest));
+                    }
+                }
+                break;
+            }
+        }
+
+        enqueue(submissionQueue, std::move(jobContainer));
+    }
+
+    m_jobsCondition.notify_one();
+
+    if (!dropped.isInternal())
     {
-        std::unique_lock<std::mutex> lock(m_indexMutex);
-        job.setIndex(m_indexCounter++);
+        reject(std::move(dropped));
     }
 
+    return true;
+}
+
+void ThreadPool::reject(JobContainer jobContainer)
+{
+    ++m_rejectedJobs;
+
+    RejectionHandler handler;
+
     {
         std::unique_lock<std::mutex> lock(m_jobsMutex);
-        m_jobs.emplace_back(job, true);
+        handler = m_rejectionHandler;
     }
 
-    m_jobsCondition.notify_one();
+    if (handler)
+    {
+        handler(jobContainer.job);
+    }
 
-    return job.index();
+    cancel(jobContainer, JobResult::State::Rejected);
 }
 
-void ThreadPool::removeJob(Job::Index index)
+void ThreadPool::complete(JobContainer& jobContainer, Job::Result result)
 {
-    std::unique_lock<std::mutex> lock(m_jobsMutex);
+    if (jobContainer.result.m_impl)
+    {
+        jobContainer.result.m_impl->set(std::move(result));
+    }
+    else if (jobContainer.completionQueue)
+    {
+        jobContainer.completionQueue->push({
+            jobContainer.job.index(),
+            JobResult::State::Finished,
+            std::move(result)
+        });
+    }
+}
 
-    m_removedJobs.push_back(index);
+void ThreadPool::cancel(JobContainer& jobContainer, JobResult::State state)
+{
+    if (jobContainer.result.m_impl)
+    {
+        jobContainer.result.m_impl->finish(state);
+    }
+    else if (jobContainer.completionQueue)
+    {
+        jobContainer.completionQueue->push({
+            jobContainer.job.index(),
+            state,
+            nullptr
+        });
+    }
 }
 
-bool ThreadPool::containsJob(Job::Index index) const
+ThreadPool::QueueIndex ThreadPool::addQueue(std::string name, uint32_t weight)
 {
     std::unique_lock<std::mutex> lock(m_jobsMutex);
 
-    auto result = std::find_if(
-        m_jobs.begin(),
-        m_jobs.end(),
-        [index](const JobContainer& c)
-        {
-            return c.job.index() == index;
-        }
-    );
+    m_queues.emplace_back(new SubmissionQueue(std::move(name), std::max(weight, 1u)));
 
-    return result != m_jobs.end();
+    return static_cast<QueueIndex>(m_queues.size() - 1);
 }
 
-void ThreadPool::workerThread(int index)
+void ThreadPool::setQueueWeight(QueueIndex queue, uint32_t weight)
 {
-    std::shared_lock<std::shared_mutex> threadLock(m_threadMutex);
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
 
-    while (m_threadContainer[index].running)
+    if (queue < m_queues.size())
     {
-        threadLock.unlock();
+        m_queues[queue]->weight = std::max(weight, 1u);
+    }
+}
 
-        // Taking job and executing it
-        JobContainer jobContainer;
+ThreadPool::QueueStatistics ThreadPool::queueStatistics(QueueIndex queue) const
+{
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
 
-        {
-            std::unique_lock<std::mutex> jobsLock(m_jobsMutex);
+    QueueStatistics statistics;
 
-            threadLock.lock();
+    if (queue < m_queues.size())
+    {
+        auto& submissionQueue = *m_queues[queue];
 
-            // If there is no jobs, going to sleep.
-            while (m_jobs.empty() &&
-                   m_threadContainer[index].running)
-            {
-                threadLock.unlock();
+        statistics.name = submissionQueue.name;
+        statistics.weight = submissionQueue.weight;
+        statistics.depth = submissionQueue.depth();
+        statistics.submitted = submissionQueue.submitted;
+        statistics.taken = submissionQueue.taken;
+    }
 
-                m_jobsCondition.wait(jobsLock);
+    return statistics;
+}
 
-                threadLock.lock();
-            }
+void ThreadPool::enqueue(SubmissionQueue& queue, JobContainer jobContainer)
+{
+    if (jobContainer.deadline != Clock::time_point::max())
+    {
+        queue.deadlineJobs.push_back(std::move(jobContainer));
+        std::push_heap(
+            queue.deadlineJobs.begin(),
+            queue.deadlineJobs.end(),
+            DeadlineComparator()
+        );
+    }
+    else
+    {
+        queue.jobs.push_back(std::move(jobContainer));
+    }
 
-            if (!m_threadContainer[index].running)
-            {
-                break;
-            }
+    ++queue.submitted;
+    ++m_queuedJobs;
+}
 
-            threadLock.unlock();
+void ThreadPool::enqueueInternal(JobContainer jobContainer)
+{
+    auto& queue = *m_queues[DefaultQueue];
 
-            // When wake up, take that job and execute it
+    if (queue.jobs.size() < MaxElements)
+    {
+        enqueue(queue, std::move(jobContainer));
+        return;
+    }
 
-            jobContainer = m_jobs.front();
-            m_jobs.pop_front();
-        }
+    m_spilledJobs.push_back(std::move(jobContainer));
+    ++queue.submitted;
+    ++m_queuedJobs;
+}
 
-        // Checking is this job removed
-        {
-            std::unique_lock<std::mutex> lock(m_removedJobsMutex);
-            auto searchResult = std::find(
-                m_removedJobs.begin(),
-                m_removedJobs.end(),
-                jobContainer.job.index()
-            );
+ThreadPool::JobContainer ThreadPool::dequeue()
+{
+    // Deficit round robin. Every job costs one
+    // unit, every round queue gets weight units.
+    while (true)
+    {
+        auto& queue = *m_queues[m_currentQueue];
 
-            if (searchResult != m_removedJobs.end())
+        // Spilled jobs have to be returned as soon as
+        // ring has space. Otherwise ring may become empty
+        // with spilled jobs left (after DropOldest moved
+        // internal job out and deadline jobs were taken).
+        if (m_currentQueue == DefaultQueue)
+        {
+            while (!m_spilledJobs.empty() &&
+                   queue.jobs.size() < MaxElements)
             {
-                m_removedJobs.erase(searchResult);
-                threadLock.lock();
-                continue;
+                queue.jobs.push_back(std::move(m_spilledJobs.front()));
+                m_spilledJobs.pop_front();
             }
         }
 
-        if (jobContainer.isInfinite)
+        if (queue.depth() != 0 &&
+            queue.deficit > 0)
         {
-            // If it's infinite, just
-            // execute it and push back.
+            --queue.deficit;
+            ++queue.taken;
+            --m_queuedJobs;
+
+            if (!queue.deadlineJobs.empty())
+            {
+                // Earliest deadline first
+                std::pop_heap(
+                    queue.deadlineJobs.begin(),
+                    queue.deadlineJobs.end(),
+                    DeadlineComparator()
+                );
+
+                auto jobContainer = std::move(queue.deadlineJobs.back());
+                queue.deadlineJobs.pop_back();
+
+                if (m_waitingSubmitters != 0)
+                {
+                    m_spaceCondition.notify_all();
+                }
+
+                return jobContainer;
+            }
+
+            auto jobContainer = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
 
-            jobContainer.job.function()();
+            // Default queue is always full, while
+            // there are spilled jobs
+            if (m_currentQueue == DefaultQueue &&
+                !m_spilledJobs.empty())
+            {
+                queue.jobs.push_back(std::move(m_spilledJobs.front()));
+                m_spilledJobs.pop_front();
+            }
+            else if (m_waitingSubmitters != 0)
+            {
+                m_spaceCondition.notify_all();
+            }
 
-            m_jobsMutex.lock();
-            m_jobs.push_back(jobContainer);
-            m_jobsMutex.unlock();
+            return jobContainer;
         }
-        else
+
+        if (queue.depth() == 0)
         {
-            // If it's not infinite, execute and update JobResult
-            // object
-            jobContainer.result.m_impl->set(jobContainer.job.function()());
+            queue.deficit = 0;
         }
 
-        threadLock.lock();
+        m_currentQueue = (m_currentQueue + 1) % m_queues.size();
+        m_queues[m_currentQueue]->deficit += m_queues[m_currentQueue]->weight;
+    }
+}
+
+JobResult ThreadPool::addJob(Job job, Clock::time_point deadline)
+{
+    return addJob(DefaultQueue, std::move(job), deadline);
+}
+
+JobResult ThreadPool::addJob(QueueIndex queue, Job job, Clock::time_point deadline)
+{
+    job.setIndex(nextIndex());
+
+    auto result = JobResult(job);
+
+    JobContainer jobContainer(std::move(job), result, deadline);
+
+    if (!submit(queue, jobContainer, m_overflowPolicy, Clock::time_point::max()))
+    {
+        // There is no such queue
+        result.m_impl->finish(JobResult::State::Rejected);
+    }
+
+    return result;
+}
+
+uint64_t ThreadPool::expiredJobs() const
+{
+    return m_expiredJobs.load();
+}
+
+Job::Index ThreadPool::addInfiniteJob(Job job)
+{
+    return addInfiniteJob(std::move(job), Clock::duration::zero());
+}
+
+Job::Index ThreadPool::addInfiniteJob(Job job, Clock::duration interval, uint32_t budget)
+{
+    job.setIndex(nextIndex());
+
+    auto index = job.index();
+
+    auto infiniteJob = std::make_unique<InfiniteJob>(
+        std::move(job),
+        interval,
+        std::max<uint32_t>(budget, 1)
+    );
+
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+        linkInfiniteJob(infiniteJob.get());
+        m_infiniteJobs.emplace(index, std::move(infiniteJob));
+    }
+
+    m_jobsCondition.notify_one();
+
+    return index;
+}
+
+void ThreadPool::linkInfiniteJob(InfiniteJob* infiniteJob)
+{
+    infiniteJob->state = InfiniteJob::State::Ready;
+    infiniteJob->previous = m_infiniteTail;
+    infiniteJob->next = nullptr;
+
+    if (m_infiniteTail)
+    {
+        m_infiniteTail->next = infiniteJob;
+    }
+    else
+    {
+        m_infiniteHead = infiniteJob;
+    }
+
+    m_infiniteTail = infiniteJob;
+}
+
+void ThreadPool::unlinkInfiniteJob(InfiniteJob* infiniteJob)
+{
+    if (infiniteJob->previous)
+    {
+        infiniteJob->previous->next = infiniteJob->next;
+    }
+    else
+    {
+        m_infiniteHead = infiniteJob->next;
     }
+
+    if (infiniteJob->next)
+    {
+        infiniteJob->next->previous = infiniteJob->previous;
+    }
+    else
+    {
+        m_infiniteTail = infiniteJob->previous;
+    }
+
+    infiniteJob->previous = nullptr;
+    infiniteJob->next = nullptr;
+}
+
+void ThreadPool::wakeInfiniteJobs(Clock::time_point now)
+{
+    while (!m_infiniteTimers.empty() &&
+           m_infiniteTimers.front()->nextRun <= now)
+    {
+        std::pop_heap(
+            m_infiniteTimers.begin(),
+            m_infiniteTimers.end(),
+            NextRunComparator()
+        );
+
+        auto infiniteJob = m_infiniteTimers.back();
+        m_infiniteTimers.pop_back();
+
+        // Removed jobs are left in heap until wake up
+        if (infiniteJob->removed)
+        {
+            m_infiniteJobs.erase(infiniteJob->job.index());
+            continue;
+        }
+
+        linkInfiniteJob(infiniteJob);
+    }
+}
+
+void ThreadPool::post(Job job)
+{
+    job.setIndex(nextIndex());
+
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+        enqueueInternal(JobContainer(job, JobType::Regular));
+    }
+
+    m_jobsCondition.notify_one();
+}
+
+JobResult ThreadPool::addKeyedJob(const std::string& key, Job job)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_keyedJobsMutex);
+
+        auto cached = m_cachedResultsIndex.find(key);
+
+        if (cached != m_cachedResultsIndex.end())
+        {
+            if (cached->second->expires > Clock::now())
+            {
+                // Marking as most recent
+                m_cachedResults.splice(
+                    m_cachedResults.begin(),
+                    m_cachedResults,
+                    cached->second
+                );
+
+                ++m_deduplicatedJobs;
+                return cached->second->result;
+            }
+
+            m_cachedResults.erase(cached->second);
+            m_cachedResultsIndex.erase(cached);
+        }
+
+        auto running = m_keyedJobs.find(key);
+
+        // Rejected or expired job is not reused
+        if (running != m_keyedJobs.end() &&
+            running->second.state() == JobResult::State::Pending)
+        {
+            ++m_deduplicatedJobs;
+            return running->second;
+        }
+    }
+
+    auto function = job.function();
+
+    Job keyed(
+        [this, key, function]()
+        {
+            auto result = function();
+            finishKeyedJob(key);
+            return result;
+        }
+    );
+
+    keyed.setIndex(nextIndex());
+
+    auto result = JobResult(keyed);
+
+    {
+        std::unique_lock<std::mutex> lock(m_keyedJobsMutex);
+
+        auto inserted = m_keyedJobs.emplace(key, result);
+
+        // Other thread has added same job meanwhile
+        if (!inserted.second)
+        {
+            if (inserted.first->second.state() == JobResult::State::Pending)
+            {
+                ++m_deduplicatedJobs;
+                return inserted.first->second;
+            }
+
+            inserted.first->second = result;
+        }
+    }
+
+    // Submitting without keyed jobs lock,
+    // because it may wait for free space
+    JobContainer jobContainer(keyed, result);
+
+    submit(DefaultQueue, jobContainer, m_overflowPolicy, Clock::time_point::max());
+
+    return result;
+}
+
+void ThreadPool::setResultCache(std::size_t capacity, Clock::duration ttl)
+{
+    std::unique_lock<std::mutex> lock(m_keyedJobsMutex);
+
+    m_cacheCapacity = capacity;
+    m_cacheTtl = ttl;
+
+    while (m_cachedResults.size() > m_cacheCapacity)
+    {
+        m_cachedResultsIndex.erase(m_cachedResults.back().key);
+        m_cachedResults.pop_back();
+    }
+}
+
+uint64_t ThreadPool::deduplicatedJobs() const
+{
+    return m_deduplicatedJobs.load();
+}
+
+void ThreadPool::finishKeyedJob(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(m_keyedJobsMutex);
+
+    auto running = m_keyedJobs.find(key);
+
+    if (running == m_keyedJobs.end())
+    {
+        return;
+    }
+
+    auto result = std::move(running->second);
+    m_keyedJobs.erase(running);
+
+    if (m_cacheCapacity == 0)
+    {
+        return;
+    }
+
+    // Value will be set right after this function,
+    // callers will wait for it
+    auto cached = m_cachedResultsIndex.find(key);
+
+    if (cached != m_cachedResultsIndex.end())
+    {
+        m_cachedResults.erase(cached->second);
+        m_cachedResultsIndex.erase(cached);
+    }
+
+    m_cachedResults.push_front({key, result, Clock::now() + m_cacheTtl});
+    m_cachedResultsIndex.emplace(key, m_cachedResults.begin());
+
+    if (m_cachedResults.size() > m_cacheCapacity)
+    {
+        m_cachedResultsIndex.erase(m_cachedResults.back().key);
+        m_cachedResults.pop_back();
+    }
+}
+
+Job::Index ThreadPool::addTriggeredJob(Job job)
+{
+    job.setIndex(nextIndex());
+
+    auto index = job.index();
+
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+    m_triggeredJobs.emplace(
+        index,
+        std::make_shared<TriggeredJob>(std::move(job))
+    );
+
+    return index;
+}
+
+void ThreadPool::trigger(Job::Index index)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+        auto iterator = m_triggeredJobs.find(index);
+
+        if (iterator == m_triggeredJobs.end())
+        {
+            return;
+        }
+
+        auto& triggered = *iterator->second;
+
+        switch (triggered.state)
+        {
+        case TriggeredJob::State::Parked:
+            break;
+
+        case TriggeredJob::State::Queued:
+            // Coalescing with queued run
+            return;
+
+        case TriggeredJob::State::Running:
+            triggered.pending = true;
+            return;
+        }
+
+        triggered.state = TriggeredJob::State::Queued;
+
+        // Only index is queued, function stays in place
+        Job placeholder;
+        placeholder.setIndex(index);
+
+        enqueueInternal(JobContainer(placeholder, JobType::Triggered));
+    }
+
+    m_jobsCondition.notify_one();
+}
+
+void ThreadPool::removeJob(Job::Index index)
+{
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+    auto infinite = m_infiniteJobs.find(index);
+
+    if (infinite != m_infiniteJobs.end())
+    {
+        auto infiniteJob = infinite->second.get();
+
+        switch (infiniteJob->state)
+        {
+        case InfiniteJob::State::Ready:
+            unlinkInfiniteJob(infiniteJob);
+            m_infiniteJobs.erase(infinite);
+            break;
+
+        case InfiniteJob::State::Waiting:
+        case InfiniteJob::State::Running:
+            // Job is destroyed by worker
+            infiniteJob->removed = true;
+            break;
+        }
+
+        return;
+    }
+
+    auto iterator = m_triggeredJobs.find(index);
+
+    if (iterator != m_triggeredJobs.end())
+    {
+        auto state = iterator->second->state;
+
+        m_triggeredJobs.erase(iterator);
+
+        // Only queued job has to be skipped by worker
+        if (state != TriggeredJob::State::Queued)
+        {
+            return;
+        }
+    }
+
+    m_removedJobs.push_back(index);
+}
+
+bool ThreadPool::containsJob(Job::Index index) const
+{
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+    auto infinite = m_infiniteJobs.find(index);
+
+    if (infinite != m_infiniteJobs.end())
+    {
+        return !infinite->second->removed;
+    }
+
+    auto predicate = [index](const JobContainer& c)
+    {
+        return c.job.index() == index;
+    };
+
+    for (auto&& queue : m_queues)
+    {
+        if (std::find_if(queue->jobs.begin(), queue->jobs.end(), predicate) != queue->jobs.end() ||
+            std::find_if(queue->deadlineJobs.begin(), queue->deadlineJobs.end(), predicate) != queue->deadlineJobs.end())
+        {
+            return true;
+        }
+    }
+
+    return std::find_if(m_spilledJobs.begin(), m_spilledJobs.end(), predicate) != m_spilledJobs.end();
+}
+
+void ThreadPool::enableWatchdog(Clock::duration threshold,
+                                StallHandler handler,
+                                bool replaceStalled)
+{
+    disableWatchdog();
+
+    {
+        std::unique_lock<std::mutex> lock(m_watchdogMutex);
+
+        m_watchdogStop = false;
+        m_watchdogThreshold = threshold;
+        m_stallHandler = std::move(handler);
+        m_replaceStalled = replaceStalled;
+    }
+
+    m_watchdogEnabled = true;
+
+    m_watchdogThread = std::thread(&ThreadPool::watchdogThread, this);
+}
+
+void ThreadPool::disableWatchdog()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_watchdogMutex);
+        m_watchdogStop = true;
+    }
+
+    m_watchdogCondition.notify_all();
+
+    if (m_watchdogThread.joinable())
+    {
+        m_watchdogThread.join();
+    }
+
+    m_watchdogEnabled = false;
+}
+
+uint64_t ThreadPool::stalledJobs() const
+{
+    return m_stalledJobs.load();
+}
+
+void ThreadPool::watchdogThread()
+{
+    std::unique_lock<std::mutex> lock(m_watchdogMutex);
+
+    auto period = std::max<Clock::duration>(
+        m_watchdogThreshold / 4,
+        std::chrono::milliseconds(1)
+    );
+
+    std::vector<StallInfo> stalled;
+
+    // Number of workers with compensating worker.
+    // Removed workers drop out of this count.
+    std::size_t replaced = 0;
+
+    while (true)
+    {
+        m_watchdogCondition.wait_for(lock, period);
+
+        if (m_watchdogStop)
+        {
+            break;
+        }
+
+        auto now = Clock::now();
+
+        std::size_t stillReplaced = 0;
+
+        {
+            std::unique_lock<std::mutex> threadLock(m_threadMutex);
+
+            for (std::size_t i = 0; i < m_threadContainer.size(); ++i)
+            {
+                auto& container = *m_threadContainer[i];
+
+                auto job = container.currentJob.load(std::memory_order_relaxed);
+                auto start = container.jobStart.load(std::memory_order_relaxed);
+
+                bool reported = job == container.reportedJob &&
+                                start == container.reportedStart;
+
+                // Stalled job has returned
+                if (container.replaced && !reported)
+                {
+                    container.replaced = false;
+                }
+
+                if (job == 0 ||
+                    reported)
+                {
+                    stillReplaced += container.replaced;
+                    continue;
+                }
+
+                auto duration = now - Clock::time_point(Clock::duration(start));
+
+                if (duration < m_watchdogThreshold)
+                {
+                    continue;
+                }
+
+                container.reportedJob = job;
+                container.reportedStart = start;
+                container.replaced = m_replaceStalled;
+
+                stillReplaced += container.replaced;
+                stalled.push_back({static_cast<int>(i), job, duration});
+            }
+        }
+
+        auto handler = m_stallHandler;
+        auto previous = replaced;
+
+        replaced = stillReplaced;
+
+        // Handler may use pool
+        lock.unlock();
+
+        for (auto&& info : stalled)
+        {
+            ++m_stalledJobs;
+
+            if (handler)
+            {
+                handler(info);
+            }
+        }
+
+        for (auto i = previous; i < replaced; ++i)
+        {
+            try
+            {
+                addBlockedWorker();
+            }
+            catch (const std::system_error&)
+            {
+                // Retried on next check
+                replaced = i;
+                break;
+            }
+        }
+
+        for (auto i = replaced; i < previous; ++i)
+        {
+            removeBlockedWorker();
+        }
+
+        stalled.clear();
+
+        lock.lock();
+    }
+
+    // Retiring compensating workers
+    {
+        std::unique_lock<std::mutex> threadLock(m_threadMutex);
+
+        for (auto&& container : m_threadContainer)
+        {
+            container->replaced = false;
+        }
+    }
+
+    lock.unlock();
+
+    for (std::size_t i = 0; i < replaced; ++i)
+    {
+        removeBlockedWorker();
+    }
+}
+
+int ThreadPool::currentWorkerIndex()
+{
+    return currentWorker;
+}
+
+int ThreadPool::workerIndex() const
+{
+    return currentPool == this ? currentWorker : -1;
+}
+
+void ThreadPool::registerWorkerLocal(WorkerLocalBase* local)
+{
+    std::unique_lock<std::mutex> lock(m_workerLocalsMutex);
+    m_workerLocals.push_back(local);
+}
+
+void ThreadPool::unregisterWorkerLocal(WorkerLocalBase* local)
+{
+    std::unique_lock<std::mutex> lock(m_workerLocalsMutex);
+    m_workerLocals.erase(
+        std::remove(m_workerLocals.begin(), m_workerLocals.end(), local),
+        m_workerLocals.end()
+    );
+}
+
+void ThreadPool::beginBlocking()
+{
+    if (currentPool != this)
+    {
+        return;
+    }
+
+    addBlockedWorker();
+}
+
+void ThreadPool::endBlocking()
+{
+    if (currentPool != this)
+    {
+        return;
+    }
+
+    removeBlockedWorker();
+}
+
+void ThreadPool::addBlockedWorker()
+{
+    reapCompensatingWorkers();
+
+    bool spawn = false;
+
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+        ++m_blockedWorkers;
+
+        if (m_compensatingWorkers < m_blockedWorkers &&
+            m_compensatingWorkers < m_maxCompensatingWorkers)
+        {
+            ++m_compensatingWorkers;
+            spawn = true;
+        }
+    }
+
+    if (spawn)
+    {
+        std::unique_lock<std::mutex> lock(m_compensatingThreadsMutex);
+
+        auto iterator = m_compensatingThreads.emplace(
+            m_compensatingThreads.end()
+        );
+
+        try
+        {
+            iterator->thread = m_threadFactory->create(
+                -1,
+                [this, iterator]()
+                {
+                    compensatingWorkerThread(iterator);
+                }
+            );
+        }
+        catch (...)
+        {
+            m_compensatingThreads.erase(iterator);
+            lock.unlock();
+
+            {
+                std::unique_lock<std::mutex> jobsLock(m_jobsMutex);
+
+                --m_compensatingWorkers;
+                --m_blockedWorkers;
+            }
+
+            throw;
+        }
+    }
+}
+
+void ThreadPool::removeBlockedWorker()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+        --m_blockedWorkers;
+    }
+
+    // Waking up compensating workers to retire
+    m_jobsCondition.notify_all();
+}
+
+void ThreadPool::reapCompensatingWorkers()
+{
+    std::unique_lock<std::mutex> lock(m_compensatingThreadsMutex);
+
+    for (auto iterator = m_compensatingThreads.begin();
+         iterator != m_compensatingThreads.end();)
+    {
+        if (iterator->finished)
+        {
+            iterator->thread.join();
+            iterator = m_compensatingThreads.erase(iterator);
+        }
+        else
+        {
+            ++iterator;
+        }
+    }
+}
+
+void ThreadPool::setMaxCompensatingWorkers(uint32_t workers)
+{
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
+    m_maxCompensatingWorkers = workers;
+}
+
+uint32_t ThreadPool::compensatingWorkers() const
+{
+    std::unique_lock<std::mutex> lock(m_jobsMutex);
+    return m_compensatingWorkers;
+}
+
+template<typename Predicate>
+bool ThreadPool::takeJob(JobContainer& jobContainer, Predicate running)
+{
+    while (true)
+    {
+        // Previous job captures and result have to be
+        // released before worker goes to sleep
+        jobContainer = JobContainer();
+
+        bool removed = false;
+
+        {
+            std::unique_lock<std::mutex> jobsLock(m_jobsMutex);
+
+            // If there is no jobs, going to sleep.
+            while (true)
+            {
+                if (!running())
+                {
+                    return false;
+                }
+
+                if (!m_infiniteTimers.empty())
+                {
+                    wakeInfiniteJobs(Clock::now());
+                }
+
+                if (m_queuedJobs != 0 ||
+                    m_infiniteHead != nullptr)
+                {
+                    break;
+                }
+
+                if (m_infiniteTimers.empty())
+                {
+                    m_jobsCondition.wait(jobsLock);
+                }
+                else
+                {
+                    // Job may be destroyed while waiting
+                    auto nextRun = m_infiniteTimers.front()->nextRun;
+
+                    m_jobsCondition.wait_until(jobsLock, nextRun);
+                }
+            }
+
+            // When wake up, take that job and execute it
+
+            if (m_infiniteHead != nullptr &&
+                (m_queuedJobs == 0 || m_infiniteTurn))
+            {
+                // Infinite jobs and queued jobs
+                // are taken in turns
+                auto infiniteJob = m_infiniteHead;
+
+                unlinkInfiniteJob(infiniteJob);
+                infiniteJob->state = InfiniteJob::State::Running;
+
+                m_infiniteTurn = false;
+
+                jobContainer = JobContainer(infiniteJob);
+                return true;
+            }
+
+            jobContainer = dequeue();
+            m_infiniteTurn = true;
+
+            // Checking is this job removed
+            if (!m_removedJobs.empty())
+            {
+                auto searchResult = std::find(
+                    m_removedJobs.begin(),
+                    m_removedJobs.end(),
+                    jobContainer.job.index()
+                );
+
+                if (searchResult != m_removedJobs.end())
+                {
+                    m_removedJobs.erase(searchResult);
+                    removed = true;
+                }
+            }
+        }
+
+        // Notifying waiters of removed job
+        if (removed)
+        {
+            cancel(jobContainer, JobResult::State::Removed);
+            continue;
+        }
+
+        // Dropping job if it's too late to execute it
+        if (jobContainer.deadline != Clock::time_point::max() &&
+            jobContainer.deadline < Clock::now())
+        {
+            ++m_expiredJobs;
+            cancel(jobContainer, JobResult::State::Expired);
+            continue;
+        }
+
+        return true;
+    }
+}
+
+void ThreadPool::executeTriggeredJob(JobContainer& jobContainer)
+{
+    auto index = jobContainer.job.index();
+
+    std::shared_ptr<TriggeredJob> triggered;
+
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+        auto iterator = m_triggeredJobs.find(index);
+
+        if (iterator == m_triggeredJobs.end())
+        {
+            return;
+        }
+
+        triggered = iterator->second;
+        triggered->state = TriggeredJob::State::Running;
+    }
+
+    // Job may be removed while it's executing,
+    // shared pointer keeps it alive
+    triggered->job.function()();
+
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+        if (!triggered->pending ||
+            m_triggeredJobs.find(index) == m_triggeredJobs.end())
+        {
+            triggered->state = TriggeredJob::State::Parked;
+            return;
+        }
+
+        triggered->pending = false;
+        triggered->state = TriggeredJob::State::Queued;
+
+        enqueueInternal(jobContainer);
+    }
+
+    m_jobsCondition.notify_one();
+}
+
+void ThreadPool::executeInfiniteJob(InfiniteJob* infiniteJob)
+{
+    // Job can't be destroyed while it's running
+    auto start = infiniteJob->interval == Clock::duration::zero() ?
+                 Clock::time_point() :
+                 Clock::now();
+
+    for (uint32_t i = 0; i < infiniteJob->budget; ++i)
+    {
+        infiniteJob->job.function()();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_jobsMutex);
+
+        if (infiniteJob->removed)
+        {
+            m_infiniteJobs.erase(infiniteJob->job.index());
+            return;
+        }
+
+        infiniteJob->nextRun = start + infiniteJob->interval;
+
+        if (infiniteJob->interval == Clock::duration::zero() ||
+            infiniteJob->nextRun <= Clock::now())
+        {
+            linkInfiniteJob(infiniteJob);
+        }
+        else
+        {
+            infiniteJob->state = InfiniteJob::State::Waiting;
+
+            m_infiniteTimers.push_back(infiniteJob);
+            std::push_heap(
+                m_infiniteTimers.begin(),
+                m_infiniteTimers.end(),
+                NextRunComparator()
+            );
+
+            // Sleeping workers wait for later timer
+            if (m_infiniteTimers.front() != infiniteJob)
+            {
+                return;
+            }
+        }
+    }
+
+    m_jobsCondition.notify_one();
+}
+
+void ThreadPool::executeJob(JobContainer& jobContainer)
+{
+    if (jobContainer.type == JobType::Triggered)
+    {
+        executeTriggeredJob(jobContainer);
+    }
+    else if (jobContainer.type == JobType::Infinite)
+    {
+        executeInfiniteJob(jobContainer.infiniteJob);
+    }
+    else if (!jobContainer.isInternal())
+    {
+        // If it's not infinite, execute and update JobResult
+        // object or completion queue
+        complete(jobContainer, jobContainer.job.function()());
+    }
+    else
+    {
+        // Internal job without result object
+        jobContainer.job.function()();
+    }
+}
+
+void ThreadPool::retireWorkerLocals(int index)
+{
+    std::unique_lock<std::mutex> lock(m_workerLocalsMutex);
+
+    for (auto&& local : m_workerLocals)
+    {
+        local->retire(index);
+    }
+}
+
+void ThreadPool::workerThread(int index, ThreadContainer& container)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    JobContainer jobContainer;
+
+    while (takeJob(
+        jobContainer,
+        [&container]()
+        {
+            return container.running.load(std::memory_order_relaxed);
+        }
+    ))
+    {
+        if (m_watchdogEnabled.load(std::memory_order_relaxed))
+        {
+            container.jobStart.store(
+                Clock::now().time_since_epoch().count(),
+                std::memory_order_relaxed
+            );
+
+            container.currentJob.store(
+                jobContainer.index(),
+                std::memory_order_relaxed
+            );
+
+            executeJob(jobContainer);
+
+            container.currentJob.store(0, std::memory_order_relaxed);
+        }
+        else
+        {
+            executeJob(jobContainer);
+        }
+    }
+
+    // Destroying worker local values
+    retireWorkerLocals(index);
+}
+
+void ThreadPool::compensatingWorkerThread(std::list<CompensatingThread>::iterator self)
+{
+    currentPool = this;
+
+    JobContainer jobContainer;
+
+    // Retiring when there are more compensating
+    // workers than blocked ones. Predicate is
+    // called under jobs mutex.
+    while (takeJob(
+        jobContainer,
+        [this]()
+        {
+            if (m_compensatingWorkers > m_blockedWorkers)
+            {
+                --m_compensatingWorkers;
+                return false;
+            }
+
+            return true;
+        }
+    ))
+    {
+        executeJob(jobContainer);
+    }
+
+    retireWorkerLocals(-1);
+
+    std::unique_lock<std::mutex> lock(m_compensatingThreadsMutex);
+    self->finished = true;
 }
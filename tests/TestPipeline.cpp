@@ -0,0 +1,108 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include "gtest/gtest.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <ThreadPool.hpp>
+#include <Pipeline.hpp>
+
+TEST(Pipeline, Stages)
+{
+    ThreadPool pool(4);
+
+    const int count = 1000;
+    const std::size_t maxTokens = 8;
+
+    int produced = 0;
+    std::atomic_size_t inFlight(0);
+    std::atomic_size_t maxInFlight(0);
+    std::atomic_int outOfOrderConcurrent(0);
+    bool overlapped = false;
+
+    std::vector<int> output;
+
+    Pipeline pipeline(
+        pool,
+        [&produced, &inFlight, &maxInFlight]() -> Job::Result
+        {
+            if (produced == count)
+            {
+                return nullptr;
+            }
+
+            auto current = ++inFlight;
+            auto previous = maxInFlight.load();
+
+            while (current > previous &&
+                   !maxInFlight.compare_exchange_weak(previous, current))
+            {}
+
+            return std::make_shared<int>(produced++);
+        }
+    );
+
+    pipeline
+        .addStage(
+            Pipeline::Mode::Parallel,
+            [](Job::Result item) -> Job::Result
+            {
+                auto value = std::static_pointer_cast<int>(item);
+
+                // Making later items faster to shuffle them
+                if (*value % 3 == 0)
+                {
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(100)
+                    );
+                }
+
+                *value *= 2;
+                return item;
+            }
+        )
+        .addStage(
+            Pipeline::Mode::SerialOutOfOrder,
+            [&outOfOrderConcurrent, &overlapped](Job::Result item) -> Job::Result
+            {
+                if (++outOfOrderConcurrent != 1)
+                {
+                    overlapped = true;
+                }
+
+                --outOfOrderConcurrent;
+                return item;
+            }
+        )
+        .addStage(
+            Pipeline::Mode::SerialInOrder,
+            [&output, &inFlight](Job::Result item) -> Job::Result
+            {
+                output.push_back(*std::static_pointer_cast<int>(item));
+                --inFlight;
+                return item;
+            }
+        );
+
+    pipeline.run(maxTokens);
+
+    ASSERT_FALSE(overlapped);
+    ASSERT_LE(maxInFlight.load(), maxTokens);
+    ASSERT_EQ(output.size(), static_cast<std::size_t>(count));
+
+    for (int i = 0; i < count; ++i)
+    {
+        ASSERT_EQ(output[i], i * 2);
+    }
+
+    // Pipeline can be executed again
+    produced = count - 10;
+    output.clear();
+
+    pipeline.run(maxTokens);
+
+    ASSERT_EQ(output.size(), 10u);
+    ASSERT_EQ(output.front(), (count - 10) * 2);
+}
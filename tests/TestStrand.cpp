@@ -0,0 +1,191 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include "gtest/gtest.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <ThreadPool.hpp>
+#include <Strand.hpp>
+
+TEST(Strand, JobsOrder)
+{
+    ThreadPool pool(4);
+
+    std::vector<int> order;
+    std::atomic_int concurrent(0);
+    bool overlapped = false;
+
+    JobResult last;
+
+    {
+        Strand strand(pool);
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            last = strand.addJob(Job(
+                [&order, &concurrent, &overlapped, i]() -> Job::Result
+                {
+                    if (++concurrent != 1)
+                    {
+                        overlapped = true;
+                    }
+
+                    order.push_back(i);
+
+                    --concurrent;
+                    return std::make_shared<int>(i);
+                }
+            ));
+        }
+
+        ASSERT_EQ(last.get<int>(), 999);
+    }
+
+    ASSERT_FALSE(overlapped);
+    ASSERT_EQ(order.size(), 1000u);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(order[i], i);
+    }
+}
+
+TEST(Strand, ManyStrands)
+{
+    ThreadPool pool(4);
+
+    std::atomic_int counter(0);
+
+    {
+        std::vector<std::unique_ptr<Strand>> strands;
+
+        for (int i = 0; i < 10000; ++i)
+        {
+            strands.emplace_back(new Strand(pool));
+        }
+
+        for (int j = 0; j < 10; ++j)
+        {
+            for (auto&& strand : strands)
+            {
+                strand->addJob(Job(
+                    [&counter]() -> Job::Result
+                    {
+                        ++counter;
+                        return nullptr;
+                    }
+                ));
+            }
+        }
+
+        // Strands destructors will wait for jobs
+    }
+
+    ASSERT_EQ(counter.load(), 100000);
+}
+
+TEST(Strand, ManyScheduledStrands)
+{
+    ThreadPool pool(1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+
+    pool.addJob(Job(
+        [&started, &release]() -> Job::Result
+        {
+            started = true;
+
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return nullptr;
+        }
+    ));
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    std::atomic_int counter(0);
+
+    {
+        std::vector<std::unique_ptr<Strand>> strands;
+
+        // Every strand schedules drain while single
+        // worker is busy, that's much more than
+        // submission queue capacity
+        for (int i = 0; i < 30000; ++i)
+        {
+            strands.emplace_back(new Strand(pool));
+            strands.back()->addJob(Job(
+                [&counter]() -> Job::Result
+                {
+                    ++counter;
+                    return nullptr;
+                }
+            ));
+        }
+
+        release = true;
+    }
+
+    ASSERT_EQ(counter.load(), 30000);
+}
+
+TEST(Strand, SurvivesDropOldest)
+{
+    ThreadPool pool(1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+
+    pool.addJob(Job(
+        [&started, &release]() -> Job::Result
+        {
+            started = true;
+
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return nullptr;
+        }
+    ));
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    Strand strand(pool);
+
+    // Strand drain is first internal job in queue
+    auto result = strand.addJob(Job(
+        []()
+        {
+            return std::make_shared<int>(1);
+        }
+    ));
+
+    auto deadline = ThreadPool::Clock::now() + std::chrono::seconds(30);
+
+    for (std::size_t i = 1; i < ThreadPool::MaxElements; ++i)
+    {
+        pool.addJob(Job([]() -> Job::Result { return nullptr; }), deadline);
+    }
+
+    // Drain is moved out of full queue
+    pool.setOverflowPolicy(ThreadPool::OverflowPolicy::DropOldest);
+    pool.addJob(Job([]() -> Job::Result { return nullptr; }), deadline);
+
+    release = true;
+
+    ASSERT_EQ(result.get<int>(), 1);
+}
@@ -0,0 +1,91 @@
+//
+// Created by agent on 10/19/26.
+//
+
+#include "gtest/gtest.h"
+#include <atomic>
+#include <vector>
+#include <ThreadPool.hpp>
+#include <TaskGraph.hpp>
+
+TEST(TaskGraph, Dependencies)
+{
+    ThreadPool pool(4);
+
+    TaskGraph graph;
+
+    // Diamond layers: every node of layer depends
+    // on all nodes of previous layer
+    const int layers = 10;
+    const int width = 20;
+
+    std::vector<std::atomic_int> finishedLayers(layers);
+    std::atomic_int violations(0);
+    std::atomic_int executed(0);
+    std::atomic_int currentRun(0);
+
+    std::vector<TaskGraph::Node> previous;
+
+    for (int layer = 0; layer < layers; ++layer)
+    {
+        std::vector<TaskGraph::Node> current;
+
+        for (int i = 0; i < width; ++i)
+        {
+            auto node = graph.addNode(
+                [&finishedLayers, &violations, &executed, &currentRun, layer]()
+                {
+                    if (layer > 0 &&
+                        finishedLayers[layer - 1].load() != currentRun * width)
+                    {
+                        ++violations;
+                    }
+
+                    ++finishedLayers[layer];
+                    ++executed;
+                }
+            );
+
+            for (auto predecessor : previous)
+            {
+                graph.precede(predecessor, node);
+            }
+
+            current.push_back(node);
+        }
+
+        previous = current;
+    }
+
+    ASSERT_FALSE(graph.run(pool));
+    ASSERT_TRUE(graph.validate());
+
+    for (int run = 1; run <= 5; ++run)
+    {
+        currentRun = run;
+
+        ASSERT_TRUE(graph.run(pool));
+        ASSERT_EQ(executed.load(), run * layers * width);
+    }
+
+    ASSERT_EQ(violations.load(), 0);
+}
+
+TEST(TaskGraph, Cycle)
+{
+    TaskGraph graph;
+
+    auto a = graph.addNode([](){});
+    auto b = graph.addNode([](){});
+    auto c = graph.addNode([](){});
+
+    graph.precede(a, b);
+    graph.precede(b, c);
+
+    ASSERT_TRUE(graph.validate());
+
+    graph.precede(c, a);
+
+    ASSERT_FALSE(graph.isValid());
+    ASSERT_FALSE(graph.validate());
+}
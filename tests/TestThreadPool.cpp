@@ -5,7 +5,12 @@
 #include "gtest/gtest.h"
 #include <thread>
 #include <ThreadPool.hpp>
+#include <WorkerLocal.hpp>
+#include <CompletionQueue.hpp>
+#include <set>
+#include <atomic>
 #include <chrono>
+#include <system_error>
 
 static Job::Result counter1()
 {
@@ -132,4 +137,1242 @@ TEST(ThreadPool, RemovingInfiniteJob)
     );
 
     ASSERT_GT(value, copy);
-}
\ No newline at end of file
+}
+TEST(ThreadPool, CurrentWorkerIndex)
+{
+    ThreadPool pool(2);
+
+    ASSERT_EQ(ThreadPool::currentWorkerIndex(), -1);
+
+    auto result = pool.addJob(Job(
+        []()
+        {
+            return std::make_shared<int>(ThreadPool::currentWorkerIndex());
+        }
+    ));
+
+    auto index = result.get<int>();
+
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, 2);
+}
+
+struct ScratchBuffer
+{
+    explicit ScratchBuffer(std::atomic_int& alive) :
+        alive(alive),
+        sum(0)
+    {
+        ++alive;
+    }
+
+    ScratchBuffer(const ScratchBuffer&) = delete;
+
+    ~ScratchBuffer()
+    {
+        --alive;
+    }
+
+    std::atomic_int& alive;
+    int sum;
+};
+
+TEST(ThreadPool, WorkerLocal)
+{
+    std::atomic_int alive(0);
+
+    ThreadPool pool(4);
+
+    {
+        WorkerLocal<ScratchBuffer> buffers(
+            pool,
+            [&alive]()
+            {
+                return ScratchBuffer(alive);
+            }
+        );
+
+        std::vector<JobResult> results;
+
+        for (int i = 1; i <= 100; ++i)
+        {
+            results.push_back(pool.addJob(Job(
+                [&buffers, i]() -> Job::Result
+                {
+                    auto& buffer = buffers.local();
+
+                    EXPECT_EQ(
+                        reinterpret_cast<std::uintptr_t>(&buffer) % ThreadPool::CacheLineSize,
+                        0u
+                    );
+
+                    buffer.sum += i;
+                    return nullptr;
+                }
+            )));
+        }
+
+        for (auto&& result : results)
+        {
+            result.waitForResult();
+        }
+
+        int total = 0;
+        buffers.forEach(
+            [&total](ScratchBuffer& buffer)
+            {
+                total += buffer.sum;
+            }
+        );
+
+        ASSERT_EQ(total, 5050);
+        ASSERT_GE(alive.load(), 1);
+        ASSERT_LE(alive.load(), 4);
+
+        // Retired workers destroy their values
+        pool.changeNumberOfThreads(0);
+
+        ASSERT_EQ(alive.load(), 0);
+
+        pool.changeNumberOfThreads(1);
+    }
+
+    ASSERT_EQ(alive.load(), 0);
+}
+
+TEST(ThreadPool, WorkerLocalOtherPool)
+{
+    ThreadPool first(1);
+    ThreadPool second(1);
+
+    WorkerLocal<int> values(first);
+
+    auto address = [&values]()
+    {
+        return std::make_shared<std::uintptr_t>(
+            reinterpret_cast<std::uintptr_t>(&values.local())
+        );
+    };
+
+    auto firstAddress = first.addJob(Job(address)).get<std::uintptr_t>();
+    auto secondAddress = second.addJob(Job(address)).get<std::uintptr_t>();
+
+    // Worker 0 of other pool gets own value
+    ASSERT_NE(firstAddress, secondAddress);
+    ASSERT_EQ(first.addJob(Job(address)).get<std::uintptr_t>(), firstAddress);
+    ASSERT_EQ(second.addJob(Job(address)).get<std::uintptr_t>(), secondAddress);
+}
+
+TEST(ThreadPool, WorkerLocalSameType)
+{
+    ThreadPool pool(1);
+
+    // More storages than cached entries
+    std::vector<std::unique_ptr<WorkerLocal<int>>> storages;
+
+    for (int i = 0; i < 12; ++i)
+    {
+        storages.emplace_back(new WorkerLocal<int>(pool));
+    }
+
+    pool.addJob(Job(
+        [&storages]() -> Job::Result
+        {
+            for (int round = 0; round < 3; ++round)
+            {
+                for (std::size_t i = 0; i < storages.size(); ++i)
+                {
+                    storages[i]->local() += static_cast<int>(i);
+                }
+            }
+
+            return nullptr;
+        }
+    )).waitForResult();
+
+    for (std::size_t i = 0; i < storages.size(); ++i)
+    {
+        int total = 0;
+
+        storages[i]->forEach(
+            [&total](int value)
+            {
+                total += value;
+            }
+        );
+
+        ASSERT_EQ(total, static_cast<int>(i) * 3);
+    }
+}
+
+TEST(ThreadPool, DeadlineJobs)
+{
+    ThreadPool pool(1);
+
+    // Blocking single worker
+    std::atomic_bool started(false);
+
+    pool.addJob(Job(
+        [&started]() -> Job::Result
+        {
+            started = true;
+
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(200)
+            );
+
+            return nullptr;
+        }
+    ));
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    std::vector<int> order;
+
+    auto makeJob = [&order](int value)
+    {
+        return Job(
+            [&order, value]()
+            {
+                order.push_back(value);
+                return std::make_shared<int>(value);
+            }
+        );
+    };
+
+    auto now = ThreadPool::Clock::now();
+
+    auto late = pool.addJob(makeJob(3), now + std::chrono::seconds(30));
+    auto expired = pool.addJob(makeJob(0), now + std::chrono::milliseconds(50));
+    auto early = pool.addJob(makeJob(1), now + std::chrono::seconds(10));
+    auto regular = pool.addJob(makeJob(4));
+    auto middle = pool.addJob(makeJob(2), now + std::chrono::seconds(20));
+
+    ASSERT_EQ(regular.get<int>(), 4);
+
+    ASSERT_EQ(expired.state(), JobResult::State::Expired);
+    ASSERT_EQ(expired.get<int>(), 0);
+    ASSERT_EQ(early.state(), JobResult::State::Finished);
+    ASSERT_EQ(middle.get<int>(), 2);
+    ASSERT_EQ(late.get<int>(), 3);
+
+    ASSERT_EQ(order, std::vector<int>({1, 2, 3, 4}));
+    ASSERT_EQ(pool.expiredJobs(), 1u);
+}
+
+TEST(ThreadPool, FinishedJobReleased)
+{
+    ThreadPool pool(1);
+
+    auto value = std::make_shared<int>(1);
+    std::weak_ptr<int> observer = value;
+
+    pool.addJob(Job(
+        [value]() -> Job::Result
+        {
+            return nullptr;
+        }
+    )).waitForResult();
+
+    value.reset();
+
+    // Idle worker doesn't keep finished job
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while (!observer.expired())
+    {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+TEST(ThreadPool, BlockingRegion)
+{
+    ThreadPool pool(1);
+
+    std::atomic_bool released(false);
+    std::atomic_bool compensated(false);
+
+    // Single worker is waiting for job, that
+    // can only be executed by compensating worker
+    auto blocked = pool.addJob(Job(
+        [&pool, &released, &compensated]()
+        {
+            pool.blocking(
+                [&pool, &released, &compensated]()
+                {
+                    compensated = pool.compensatingWorkers() == 1;
+
+                    auto start = std::chrono::steady_clock::now();
+
+                    while (!released &&
+                           std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+                    {
+                        std::this_thread::sleep_for(
+                            std::chrono::milliseconds(1)
+                        );
+                    }
+                }
+            );
+
+            return std::make_shared<bool>(released);
+        }
+    ));
+
+    auto releaser = pool.addJob(Job(
+        [&released]() -> Job::Result
+        {
+            released = true;
+            return nullptr;
+        }
+    ));
+
+    releaser.waitForResult();
+
+    ASSERT_TRUE(blocked.get<bool>());
+    ASSERT_TRUE(compensated);
+
+    // Blocking function result is forwarded
+    ASSERT_EQ(pool.blocking([]() { return 42; }), 42);
+}
+
+TEST(ThreadPool, Map)
+{
+    ThreadPool pool(4);
+
+    std::vector<int> input(10000);
+
+    for (int i = 0; i < static_cast<int>(input.size()); ++i)
+    {
+        input[i] = i;
+    }
+
+    auto results = pool.map(
+        input,
+        [](int value)
+        {
+            return static_cast<int64_t>(value) * value;
+        }
+    );
+
+    ASSERT_EQ(results.size(), input.size());
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        ASSERT_EQ(results[i], static_cast<int64_t>(i) * i);
+    }
+
+    ASSERT_TRUE(pool.map(std::vector<int>(), [](int v) { return v; }).empty());
+}
+
+TEST(ThreadPool, MapFromWorker)
+{
+    ThreadPool pool(1);
+
+    // Single worker is busy with caller,
+    // so caller has to process chunks itself
+    auto result = pool.addJob(Job(
+        [&pool]()
+        {
+            auto values = pool.map(
+                std::vector<int>({1, 2, 3, 4, 5}),
+                [](int value)
+                {
+                    return value * 2;
+                }
+            );
+
+            int sum = 0;
+
+            for (auto value : values)
+            {
+                sum += value;
+            }
+
+            return std::make_shared<int>(sum);
+        }
+    ));
+
+    ASSERT_EQ(result.get<int>(), 30);
+}
+
+TEST(ThreadPool, WeightedQueues)
+{
+    ThreadPool pool(1);
+
+    auto heavy = pool.addQueue("heavy", 3);
+    auto light = pool.addQueue("light", 1);
+
+    // Blocking single worker until all jobs are added
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+
+    pool.addJob(Job(
+        [&started, &release]() -> Job::Result
+        {
+            started = true;
+
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return nullptr;
+        }
+    ));
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    std::vector<ThreadPool::QueueIndex> order;
+    JobResult last;
+
+    for (int i = 0; i < 40; ++i)
+    {
+        for (auto queue : {heavy, light})
+        {
+            last = pool.addJob(
+                queue,
+                Job(
+                    [&order, queue]() -> Job::Result
+                    {
+                        order.push_back(queue);
+                        return nullptr;
+                    }
+                )
+            );
+        }
+    }
+
+    ASSERT_EQ(pool.queueStatistics(heavy).depth, 40u);
+    ASSERT_EQ(pool.queueStatistics(light).name, "light");
+
+    release = true;
+
+    last.waitForResult();
+
+    ASSERT_EQ(order.size(), 80u);
+
+    // While both queues have jobs, heavy one gets 3/4 of them
+    auto heavyJobs = std::count(order.begin(), order.begin() + 40, heavy);
+
+    ASSERT_EQ(heavyJobs, 30);
+
+    auto statistics = pool.queueStatistics(light);
+
+    ASSERT_EQ(statistics.depth, 0u);
+    ASSERT_EQ(statistics.submitted, 40u);
+    ASSERT_EQ(statistics.taken, 40u);
+
+    // Unknown queue
+    auto invalid = pool.addJob(100, Job(counter1));
+
+    ASSERT_TRUE(invalid.state() == JobResult::State::Rejected);
+    ASSERT_TRUE(pool.addJob(100, Job(counter1), ThreadPool::Clock::now()).state() == JobResult::State::Rejected);
+}
+
+TEST(ThreadPool, WeightedQueuesDeadlines)
+{
+    ThreadPool pool(1);
+
+    auto heavy = pool.addQueue("heavy", 3);
+    auto light = pool.addQueue("light", 1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+
+    pool.addJob(Job(
+        [&started, &release]() -> Job::Result
+        {
+            started = true;
+
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return nullptr;
+        }
+    ));
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    std::vector<ThreadPool::QueueIndex> order;
+    std::vector<JobResult> results;
+
+    auto makeJob = [&order](ThreadPool::QueueIndex queue)
+    {
+        return Job(
+            [&order, queue]() -> Job::Result
+            {
+                order.push_back(queue);
+                return nullptr;
+            }
+        );
+    };
+
+    auto deadline = ThreadPool::Clock::now() + std::chrono::seconds(30);
+
+    for (int i = 0; i < 40; ++i)
+    {
+        results.push_back(pool.addJob(heavy, makeJob(heavy)));
+        results.push_back(pool.addJob(light, makeJob(light), deadline));
+    }
+
+    ASSERT_EQ(pool.queueStatistics(light).depth, 40u);
+
+    release = true;
+
+    for (auto&& result : results)
+    {
+        result.waitForResult();
+    }
+
+    // Deadlines don't give light queue more than it's share
+    auto heavyJobs = std::count(order.begin(), order.begin() + 40, heavy);
+
+    ASSERT_EQ(heavyJobs, 30);
+}
+
+TEST(ThreadPool, AdmissionControl)
+{
+    ThreadPool pool(1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+
+    pool.addJob(Job(
+        [&started, &release]() -> Job::Result
+        {
+            started = true;
+
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return nullptr;
+        }
+    ));
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    std::vector<JobResult> results;
+
+    for (std::size_t i = 0; i < ThreadPool::MaxElements; ++i)
+    {
+        results.push_back(pool.tryAddJob(Job(counter1)));
+        ASSERT_EQ(results.back().state(), JobResult::State::Pending);
+    }
+
+    std::atomic_int handled(0);
+
+    pool.setRejectionHandler(
+        [&handled](const Job&)
+        {
+            ++handled;
+        }
+    );
+
+    // Queue is full
+    ASSERT_EQ(pool.tryAddJob(Job(counter2)).state(), JobResult::State::Rejected);
+
+    auto timedOut = pool.addJobFor(Job(counter2), std::chrono::milliseconds(10));
+    ASSERT_EQ(timedOut.state(), JobResult::State::Rejected);
+
+    pool.setOverflowPolicy(ThreadPool::OverflowPolicy::CallerRuns);
+
+    auto callerRuns = pool.addJob(Job(counter3));
+    ASSERT_EQ(callerRuns.state(), JobResult::State::Finished);
+    ASSERT_EQ(callerRuns.get<int>(), 300);
+
+    pool.setOverflowPolicy(ThreadPool::OverflowPolicy::DropOldest);
+
+    auto newest = pool.addJob(Job(counter4));
+    ASSERT_EQ(results.front().state(), JobResult::State::Rejected);
+    ASSERT_EQ(results.front().get<int>(), 0);
+
+    pool.setOverflowPolicy(ThreadPool::OverflowPolicy::Reject);
+    ASSERT_EQ(pool.addJob(Job(counter5)).state(), JobResult::State::Rejected);
+
+    ASSERT_EQ(pool.rejectedJobs(), 4u);
+    ASSERT_EQ(handled.load(), 4);
+    ASSERT_EQ(pool.overflowedJobs(), 5u);
+
+    release = true;
+
+    ASSERT_EQ(newest.get<int>(), 400);
+    ASSERT_EQ(results.back().get<int>(), 100);
+}
+
+TEST(ThreadPool, AdmissionControlFromWorker)
+{
+    ThreadPool pool(1);
+
+    std::atomic_int executed(0);
+
+    // Single worker fills it's own queue
+    auto result = pool.addJob(Job(
+        [&pool, &executed]()
+        {
+            for (std::size_t i = 0; i < ThreadPool::MaxElements + 100; ++i)
+            {
+                pool.addJob(Job(
+                    [&executed]() -> Job::Result
+                    {
+                        ++executed;
+                        return nullptr;
+                    }
+                ));
+            }
+
+            // Overflowing jobs were executed here
+            return std::make_shared<int>(executed.load());
+        }
+    ));
+
+    ASSERT_EQ(result.get<int>(), 100);
+    ASSERT_EQ(pool.overflowedJobs(), 100u);
+}
+
+TEST(ThreadPool, AdmissionControlDeadlines)
+{
+    ThreadPool pool(1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+
+    pool.addJob(Job(
+        [&started, &release]() -> Job::Result
+        {
+            started = true;
+
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return nullptr;
+        }
+    ));
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    pool.setOverflowPolicy(ThreadPool::OverflowPolicy::Reject);
+
+    auto deadline = ThreadPool::Clock::now() + std::chrono::seconds(30);
+
+    std::vector<JobResult> results;
+
+    for (std::size_t i = 0; i < ThreadPool::MaxElements; ++i)
+    {
+        results.push_back(pool.addJob(Job(counter1), deadline));
+    }
+
+    // Jobs with deadline are counted in queue size
+    auto rejectedDeadline = pool.addJob(Job(counter2), deadline);
+    auto rejectedRegular = pool.addJob(Job(counter2));
+
+    // Least urgent queued job is dropped
+    pool.setOverflowPolicy(ThreadPool::OverflowPolicy::DropOldest);
+
+    auto late = pool.addJob(Job(counter4), deadline + std::chrono::seconds(1));
+    auto urgent = pool.addJob(Job(counter3), deadline - std::chrono::seconds(1));
+
+    release = true;
+
+    ASSERT_EQ(rejectedDeadline.state(), JobResult::State::Rejected);
+    ASSERT_EQ(rejectedRegular.state(), JobResult::State::Rejected);
+    ASSERT_EQ(late.state(), JobResult::State::Rejected);
+    ASSERT_EQ(urgent.get<int>(), 300);
+
+    auto dropped = std::count_if(
+        results.begin(),
+        results.end(),
+        [](JobResult& result)
+        {
+            result.waitForResult();
+            return result.state() == JobResult::State::Rejected;
+        }
+    );
+
+    ASSERT_EQ(dropped, 1);
+    ASSERT_EQ(pool.rejectedJobs(), 4u);
+}
+
+TEST(ThreadPool, TriggeredJob)
+{
+    ThreadPool pool(2);
+
+    std::atomic_int runs(0);
+    std::atomic_bool release(false);
+
+    auto index = pool.addTriggeredJob(Job(
+        [&runs, &release]() -> Job::Result
+        {
+            ++runs;
+
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return nullptr;
+        }
+    ));
+
+    // Parked job is not executed
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(runs.load(), 0);
+    ASSERT_FALSE(pool.containsJob(index));
+
+    pool.trigger(index);
+
+    while (runs.load() != 1)
+    {
+        std::this_thread::yield();
+    }
+
+    // Triggers while running are coalesced to one run
+    pool.trigger(index);
+    pool.trigger(index);
+    pool.trigger(index);
+
+    release = true;
+
+    while (runs.load() != 2)
+    {
+        std::this_thread::yield();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(runs.load(), 2);
+
+    pool.removeJob(index);
+    pool.trigger(index);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(runs.load(), 2);
+}
+
+TEST(ThreadPool, ThreadFactory)
+{
+    std::atomic_int started(0);
+    std::atomic_int stopped(0);
+
+    ThreadFactory::Options options;
+    options.name = "pool-test";
+    options.stackSize = 256 * 1024;
+    options.onStart = [&started](int) { ++started; };
+    options.onStop = [&stopped](int) { ++stopped; };
+
+    {
+        ThreadPool pool(2, std::make_shared<ThreadFactory>(options));
+
+        std::vector<JobResult> results;
+
+        for (int i = 0; i < 2; ++i)
+        {
+            results.push_back(pool.addJob(Job(
+                []()
+                {
+                    char name[16] = {};
+                    pthread_getname_np(pthread_self(), name, sizeof(name));
+
+                    pthread_attr_t attributes;
+                    pthread_getattr_np(pthread_self(), &attributes);
+
+                    std::size_t stackSize = 0;
+                    pthread_attr_getstacksize(&attributes, &stackSize);
+                    pthread_attr_destroy(&attributes);
+
+                    return std::make_shared<std::string>(
+                        std::string(name) + ":" + std::to_string(stackSize)
+                    );
+                }
+            )));
+        }
+
+        for (auto&& result : results)
+        {
+            auto value = result.get<std::string>();
+
+            ASSERT_TRUE(value == "pool-test/0:262144" || value == "pool-test/1:262144") << value;
+        }
+    }
+
+    // Workers are joined here, so hooks have been called
+    ASSERT_EQ(started.load(), 2);
+    ASSERT_EQ(stopped.load(), 2);
+
+    // Too small stack is not replaced with default one
+    options.stackSize = 1;
+
+    ThreadFactory factory(options);
+
+    ASSERT_THROW(factory.create(0, [](){}), std::system_error);
+}
+
+/**
+ * @brief Factory, that fails to create thread
+ * after limit and creates other threads itself.
+ */
+class LimitedThreadFactory : public ThreadFactory
+{
+public:
+    LimitedThreadFactory(Options options, int limit) :
+        ThreadFactory(std::move(options)),
+        m_limit(limit),
+        m_created(0)
+    {
+
+    }
+
+    Thread create(int index, std::function<void()> body) override
+    {
+        if (m_created == m_limit)
+        {
+            throw std::system_error(EAGAIN, std::generic_category(), "limit");
+        }
+
+        ++m_created;
+
+        auto data = new StartData{this, index, std::move(body)};
+
+        pthread_t handle;
+        pthread_create(&handle, nullptr, &LimitedThreadFactory::start, data);
+
+        return adopt(handle);
+    }
+
+private:
+    struct StartData
+    {
+        LimitedThreadFactory* factory;
+        int index;
+        std::function<void()> body;
+    };
+
+    static void* start(void* argument)
+    {
+        std::unique_ptr<StartData> data(static_cast<StartData*>(argument));
+        data->factory->run(data->index, data->body);
+        return nullptr;
+    }
+
+    int m_limit;
+    int m_created;
+};
+
+TEST(ThreadPool, ThreadFactoryFailure)
+{
+    std::atomic_int started(0);
+    std::atomic_int stopped(0);
+
+    ThreadFactory::Options options;
+    options.onStart = [&started](int) { ++started; };
+    options.onStop = [&stopped](int) { ++stopped; };
+
+    // Started workers are joined, when constructor fails
+    ASSERT_THROW(
+        ThreadPool(4, std::make_shared<LimitedThreadFactory>(options, 2)),
+        std::system_error
+    );
+
+    ASSERT_EQ(started.load(), 2);
+    ASSERT_EQ(stopped.load(), 2);
+
+    // Number of threads is kept on failure
+    ThreadPool pool(1, std::make_shared<LimitedThreadFactory>(options, 2));
+
+    ASSERT_THROW(pool.changeNumberOfThreads(3), std::system_error);
+    ASSERT_EQ(pool.numberOfThreads(), 1u);
+
+    ASSERT_EQ(pool.addJob(Job(counter1)).get<int>(), 100);
+}
+
+TEST(ThreadPool, CompletionQueue)
+{
+    ThreadPool pool(4);
+    CompletionQueue completions;
+
+    ASSERT_FALSE(completions.poll().has_value());
+
+    std::atomic_bool release(false);
+
+    // Slow job is finished last despite
+    // being added first
+    auto slow = pool.addJob(
+        Job(
+            [&release]()
+            {
+                while (!release)
+                {
+                    std::this_thread::yield();
+                }
+
+                return std::make_shared<int>(-1);
+            }
+        ),
+        completions
+    );
+
+    std::set<Job::Index> indices;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        indices.insert(pool.addJob(
+            Job(
+                [i]()
+                {
+                    return std::make_shared<int>(i);
+                }
+            ),
+            completions
+        ));
+    }
+
+    int sum = 0;
+
+    for (int i = 0; i < 50; ++i)
+    {
+        auto completion = completions.waitOne();
+
+        ASSERT_EQ(completion.state, JobResult::State::Finished);
+        ASSERT_EQ(indices.erase(completion.index), 1u);
+        sum += *std::static_pointer_cast<int>(completion.result);
+    }
+
+    while (!indices.empty())
+    {
+        for (auto&& completion : completions.drain(10))
+        {
+            ASSERT_EQ(indices.erase(completion.index), 1u);
+            sum += *std::static_pointer_cast<int>(completion.result);
+        }
+    }
+
+    ASSERT_EQ(sum, 4950);
+    ASSERT_EQ(completions.size(), 0u);
+
+    release = true;
+
+    auto last = completions.waitOne();
+    ASSERT_EQ(last.index, slow);
+    ASSERT_EQ(*std::static_pointer_cast<int>(last.result), -1);
+}
+
+TEST(ThreadPool, CompletionQueueRemovedJob)
+{
+    ThreadPool pool(1);
+
+    CompletionQueue completions;
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+
+    auto blocker = pool.addJob(
+        Job(
+            [&started, &release]() -> Job::Result
+            {
+                started = true;
+
+                while (!release)
+                {
+                    std::this_thread::yield();
+                }
+
+                return nullptr;
+            }
+        ),
+        completions
+    );
+
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+
+    auto removed = pool.addJob(Job(counter1), completions);
+
+    pool.removeJob(removed);
+
+    release = true;
+
+    // Every job produces completion
+    std::set<Job::Index> indices;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        auto completion = completions.waitOne();
+
+        indices.insert(completion.index);
+
+        ASSERT_EQ(
+            completion.state,
+            completion.index == removed ?
+                JobResult::State::Removed :
+                JobResult::State::Finished
+        );
+    }
+
+    ASSERT_EQ(indices, std::set<Job::Index>({blocker, removed}));
+}
+
+TEST(ThreadPool, KeyedJobs)
+{
+    ThreadPool pool(1);
+
+    pool.setResultCache(1, std::chrono::milliseconds(200));
+
+    std::atomic_int executed(0);
+    std::atomic_bool release(false);
+
+    auto makeJob = [&executed, &release](int value)
+    {
+        return Job(
+            [&executed, &release, value]()
+            {
+                while (!release)
+                {
+                    std::this_thread::yield();
+                }
+
+                ++executed;
+                return std::make_shared<int>(value);
+            }
+        );
+    };
+
+    // Equal keys share running job
+    auto first = pool.addKeyedJob("config", makeJob(1));
+    auto second = pool.addKeyedJob("config", makeJob(2));
+    auto other = pool.addKeyedJob("asset", makeJob(3));
+
+    release = true;
+
+    ASSERT_EQ(first.get<int>(), 1);
+    ASSERT_EQ(second.get<int>(), 1);
+    ASSERT_EQ(other.get<int>(), 3);
+    ASSERT_EQ(executed.load(), 2);
+
+    // "asset" has pushed "config" out of cache
+    ASSERT_EQ(pool.addKeyedJob("asset", makeJob(4)).get<int>(), 3);
+    ASSERT_EQ(pool.addKeyedJob("config", makeJob(5)).get<int>(), 5);
+    ASSERT_EQ(executed.load(), 3);
+
+    ASSERT_EQ(pool.deduplicatedJobs(), 2u);
+
+    // Cached result expires
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+    ASSERT_EQ(pool.addKeyedJob("config", makeJob(6)).get<int>(), 6);
+    ASSERT_EQ(executed.load(), 4);
+}
+
+TEST(ThreadPool, Watchdog)
+{
+    ThreadPool pool(1);
+
+    std::atomic_bool release(false);
+    std::atomic<Job::Index> reportedJob(0);
+    std::atomic_int reports(0);
+
+    pool.enableWatchdog(
+        std::chrono::milliseconds(20),
+        [&](const ThreadPool::StallInfo& info)
+        {
+            reportedJob = info.jobIndex;
+            ++reports;
+        },
+        true
+    );
+
+    auto stalled = pool.addJob(Job(
+        [&release]()
+        {
+            while (!release)
+            {
+                std::this_thread::yield();
+            }
+
+            return std::make_shared<int>(1);
+        }
+    ));
+
+    // Replacement worker runs other jobs
+    auto other = pool.addJob(Job(
+        []()
+        {
+            return std::make_shared<int>(2);
+        }
+    ));
+
+    ASSERT_EQ(other.get<int>(), 2);
+    ASSERT_EQ(pool.numberOfThreads(), 1u);
+    ASSERT_EQ(pool.compensatingWorkers(), 1u);
+    ASSERT_EQ(reports.load(), 1);
+    ASSERT_EQ(pool.stalledJobs(), 1u);
+
+    release = true;
+
+    ASSERT_EQ(stalled.get<int>(), 1);
+    ASSERT_NE(reportedJob.load(), 0u);
+
+    // Replacement retires after stalled job returns
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while (pool.compensatingWorkers() != 0)
+    {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    pool.disableWatchdog();
+}
+
+TEST(ThreadPool, WatchdogRepeatedStall)
+{
+    ThreadPool pool(1);
+
+    std::atomic_int runs(0);
+    std::atomic_int reports(0);
+
+    pool.enableWatchdog(
+        std::chrono::milliseconds(20),
+        [&reports](const ThreadPool::StallInfo&)
+        {
+            ++reports;
+        }
+    );
+
+    // Infinite job keeps index between runs
+    auto index = pool.addInfiniteJob(Job(
+        [&runs]()
+        {
+            if (++runs <= 2)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+
+            return nullptr;
+        }
+    ));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while (reports.load() < 2)
+    {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    pool.removeJob(index);
+    pool.disableWatchdog();
+
+    ASSERT_EQ(pool.stalledJobs(), 2u);
+}
+
+TEST(ThreadPool, ManyInfiniteJobs)
+{
+    ThreadPool pool(2);
+
+    const int jobs = 5000;
+
+    std::vector<std::atomic_int> runs(jobs);
+    std::vector<Job::Index> indices;
+
+    for (int i = 0; i < jobs; ++i)
+    {
+        indices.push_back(pool.addInfiniteJob(Job(
+            [&runs, i]()
+            {
+                ++runs[i];
+                return nullptr;
+            }
+        )));
+    }
+
+    // Regular jobs are not starved by infinite ones
+    auto result = pool.addJob(Job(
+        []()
+        {
+            return std::make_shared<int>(1);
+        }
+    ));
+
+    ASSERT_EQ(result.get<int>(), 1);
+
+    // Every job gets executed
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+    while (std::any_of(runs.begin(), runs.end(), [](const std::atomic_int& v) { return v == 0; }))
+    {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        std::this_thread::yield();
+    }
+
+    for (auto&& index : indices)
+    {
+        ASSERT_TRUE(pool.containsJob(index));
+        pool.removeJob(index);
+        ASSERT_FALSE(pool.containsJob(index));
+    }
+
+    // Let running jobs finish
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::vector<int> copy(runs.begin(), runs.end());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    ASSERT_TRUE(std::equal(copy.begin(), copy.end(), runs.begin()));
+}
+
+TEST(ThreadPool, InfiniteJobInterval)
+{
+    ThreadPool pool(2);
+
+    std::atomic_int runs(0);
+
+    auto index = pool.addInfiniteJob(
+        Job(
+            [&runs]()
+            {
+                ++runs;
+                return nullptr;
+            }
+        ),
+        std::chrono::milliseconds(50),
+        2
+    );
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(230));
+
+    pool.removeJob(index);
+
+    // 5 passes with 2 runs each
+    ASSERT_GE(runs.load(), 6);
+    ASSERT_LE(runs.load(), 10);
+    ASSERT_EQ(runs.load() % 2, 0);
+
+    auto copy = runs.load();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ASSERT_EQ(runs.load(), copy);
+}